@@ -0,0 +1,338 @@
+#include "libcurl-wrapper/asynctracewriter.hpp"
+
+#include <fmt/core.h>
+
+namespace curl
+{
+
+namespace
+{
+
+constexpr size_t outputBufferSize = 256 * 1024;
+constexpr size_t maxRetainedDataCapacity = 64 * 1024; // a cell doesn't keep the memory of a single huge entry forever
+
+}
+
+AsyncTraceWriter::AsyncTraceWriter(const cu::Logger &logger, size_t capacity)
+    : m_logger(logger)
+{
+    size_t cellCount = 2;
+    while(cellCount < capacity)
+        cellCount *= 2;
+
+    m_cells = std::vector<Cell>(cellCount);
+    m_mask = cellCount - 1;
+    for(size_t i = 0; i < cellCount; i++)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    m_thread = std::make_unique<std::thread>(&AsyncTraceWriter::threadedFunction, this);
+}
+
+AsyncTraceWriter::~AsyncTraceWriter()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_threadKeepRunning = false;
+    }
+    m_wakeupCondition.notify_one();
+
+    if(m_thread && m_thread->joinable())
+        m_thread->join();
+
+    // Only outputs, whose AsyncTraceFile was never finalized, are left; there are no producers anymore
+    for(Output *output : m_outputs)
+        delete output;
+}
+
+void AsyncTraceWriter::flush()
+{
+    size_t position = m_enqueuePosition.load();
+
+    std::unique_lock<std::mutex> lock(m_waitMutex);
+    m_flushRequests++;
+    m_wakeupCondition.notify_one();
+    m_flushedCondition.wait(lock, [&]{ return m_flushedPosition >= position; });
+    m_flushRequests--;
+}
+
+uint64_t AsyncTraceWriter::writtenEntries() const
+{
+    return m_writtenEntries;
+}
+
+uint64_t AsyncTraceWriter::droppedEntries() const
+{
+    return m_droppedEntries;
+}
+
+AsyncTraceWriter::Output *AsyncTraceWriter::_openOutput(const std::string &filename)
+{
+    auto output = std::make_unique<Output>();
+    output->filename = filename;
+    output->buffer.reset(new char[outputBufferSize]);
+    output->file.rdbuf()->pubsetbuf(output->buffer.get(), outputBufferSize); // only effective before open()
+
+    output->file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!output->file.is_open())
+    {
+        std::string errMsg = fmt::format("failed to open trace file {}", filename);
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    return output.release();
+}
+
+bool AsyncTraceWriter::_tryPush(const Entry &entry, std::string_view data)
+{
+    if(enqueue(entry, data))
+        return true;
+
+    m_droppedEntries++;
+    return false;
+}
+
+void AsyncTraceWriter::_push(const Entry &entry)
+{
+    while(!enqueue(entry, std::string_view()))
+    {
+        m_wakeupCondition.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+bool AsyncTraceWriter::enqueue(const Entry &entry, std::string_view data)
+{
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    Cell *cell;
+
+    // A cell is free for the position, when its sequence equals the position, and written, when it is the position + 1
+    for(;;)
+    {
+        cell = &m_cells[position & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if(difference == 0)
+        {
+            if(m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+            return false; // full: the thread hasn't written the entry of the previous round yet
+        else
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+    }
+
+    cell->entry = entry;
+    cell->data.assign(data.data(), data.size());
+    cell->sequence.store(position + 1, std::memory_order_release);
+
+    // The thread sleeps up to 10 ms: only wake it, before the ring gets tight
+    if(m_sleeping.load(std::memory_order_relaxed) && (position - m_dequeuePosition.load(std::memory_order_relaxed) >= m_mask / 4))
+        m_wakeupCondition.notify_one();
+
+    return true;
+}
+
+void AsyncTraceWriter::threadedFunction()
+{
+    for(;;)
+    {
+        while(writeNextEntry())
+        {
+        }
+
+        flushOutputs();
+
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_flushedPosition = m_dequeuePosition.load();
+        m_flushedCondition.notify_all();
+
+        if(!m_threadKeepRunning && (m_dequeuePosition.load() == m_enqueuePosition.load()))
+            break;
+
+        if(m_flushRequests > 0)
+        {
+            // An entry may be claimed, but not yet published: look again soon
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+
+        m_sleeping = true;
+        m_wakeupCondition.wait_for(lock, std::chrono::milliseconds(10));
+        m_sleeping = false;
+    }
+
+    m_logger->debug("trace writer finished");
+}
+
+bool AsyncTraceWriter::writeNextEntry()
+{
+    size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    Cell &cell = m_cells[position & m_mask];
+
+    if(cell.sequence.load(std::memory_order_acquire) != position + 1)
+        return false;
+
+    writeEntry(cell.entry, cell.data);
+
+    if(cell.data.capacity() > maxRetainedDataCapacity)
+        std::string().swap(cell.data);
+    else
+        cell.data.clear();
+
+    cell.sequence.store(position + m_mask + 1, std::memory_order_release); // free for the next round
+    m_dequeuePosition.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncTraceWriter::writeEntry(const Entry &entry, std::string &data)
+{
+    Output *output = entry.output;
+    if(output == nullptr)
+        return;
+
+    m_outputs.insert(output);
+
+    if(entry.droppedBefore > 0)
+        output->file << "### " << entry.droppedBefore << " trace entries dropped ###\n";
+
+    switch(entry.kind)
+    {
+    case EntryKind::CURL_DEBUG_INFO:
+        TraceFile::writeCurlDebugInfo(output->file, entry.type, data.data(), entry.size, entry.time, entry.payload, entry.maxDataSize);
+        m_writtenEntries++;
+        break;
+
+    case EntryKind::MESSAGE:
+        output->file.write(data.data(), data.size());
+        m_writtenEntries++;
+        break;
+
+    case EntryKind::CLOSE:
+        output->file.close();
+        if(output->file.fail())
+            m_logger->error(fmt::format("failed to write trace file {}", output->filename));
+
+        m_outputs.erase(output);
+        delete output;
+        break;
+    }
+}
+
+void AsyncTraceWriter::flushOutputs()
+{
+    for(Output *output : m_outputs)
+        output->file.flush();
+}
+
+AsyncTraceFile::AsyncTraceFile(const cu::Logger &logger, std::shared_ptr<AsyncTraceWriter> writer)
+    : m_logger(logger),
+      m_writer(std::move(writer))
+{
+
+}
+
+AsyncTraceFile::~AsyncTraceFile()
+{
+    finalize();
+}
+
+void AsyncTraceFile::initialize()
+{
+    m_logger->info(fmt::format("create trace file: {}", m_filename));
+
+    finalize(); // a transfer, which is traced again, starts a new file
+    m_output = m_writer->_openOutput(m_filename);
+    m_timepointTransferBegin = std::chrono::steady_clock::now();
+}
+
+void AsyncTraceFile::finalize()
+{
+    if(m_output == nullptr)
+        return;
+
+    AsyncTraceWriter::Entry entry;
+    entry.output = m_output;
+    entry.kind = AsyncTraceWriter::EntryKind::CLOSE;
+    entry.droppedBefore = m_droppedSinceLastEntry;
+    m_writer->_push(entry);
+
+    m_output = nullptr;
+    m_droppedSinceLastEntry = 0;
+}
+
+void AsyncTraceFile::traceCurlDebugInfo([[maybe_unused]] CURL *handle, curl_infotype type, char *data, size_t size)
+{
+    if(m_output == nullptr)
+        return;
+
+    AsyncTraceWriter::Entry entry;
+    entry.kind = AsyncTraceWriter::EntryKind::CURL_DEBUG_INFO;
+    entry.type = type;
+    entry.size = size;
+    entry.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_timepointTransferBegin);
+    entry.payload = TraceFile::tracePayload(type, size, m_enableSslData, m_maxDataSize, m_dataSize);
+    entry.maxDataSize = m_maxDataSize;
+
+    // Only the data, which is written, is copied
+    push(entry, (entry.payload == TracePayload::DATA) ? std::string_view(data, size) : std::string_view());
+}
+
+void AsyncTraceFile::traceMessage(std::string_view entry)
+{
+    if(m_output == nullptr)
+        return;
+
+    AsyncTraceWriter::Entry messageEntry;
+    messageEntry.kind = AsyncTraceWriter::EntryKind::MESSAGE;
+    push(messageEntry, entry);
+}
+
+void AsyncTraceFile::push(AsyncTraceWriter::Entry &entry, std::string_view data)
+{
+    entry.output = m_output;
+    entry.droppedBefore = m_droppedSinceLastEntry;
+
+    if(m_writer->_tryPush(entry, data))
+        m_droppedSinceLastEntry = 0;
+    else
+    {
+        m_droppedSinceLastEntry++;
+        m_droppedEntries++;
+    }
+}
+
+const std::string &AsyncTraceFile::filename() const
+{
+    return m_filename;
+}
+
+void AsyncTraceFile::setFilename(const std::string &newFilename)
+{
+    m_filename = newFilename;
+}
+
+uint32_t AsyncTraceFile::maxDataSize() const
+{
+    return m_maxDataSize;
+}
+
+void AsyncTraceFile::setMaxDataSize(uint32_t newMaxDataSize)
+{
+    m_maxDataSize = newMaxDataSize;
+}
+
+void AsyncTraceFile::enableSslData(bool newEnableSslData)
+{
+    m_enableSslData = newEnableSslData;
+}
+
+uint64_t AsyncTraceFile::droppedEntries() const
+{
+    return m_droppedEntries;
+}
+
+}
@@ -0,0 +1,181 @@
+#include "libcurl-wrapper/bandwidthlimiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace curl
+{
+
+namespace
+{
+
+// Short bursts keep the rate accurate even for short transfers; the minimum avoids pausing after every single read
+constexpr double burstDuration_s = 0.05;
+constexpr double minBurst_bytes = 16 * 1024;
+
+}
+
+BandwidthLimiter::BandwidthLimiter(uint64_t maxUploadBytesPerSecond, uint64_t maxDownloadBytesPerSecond)
+    : m_lastRefill(std::chrono::steady_clock::now())
+{
+    m_maxBytesPerSecond[UPLOAD] = maxUploadBytesPerSecond;
+    m_maxBytesPerSecond[DOWNLOAD] = maxDownloadBytesPerSecond;
+
+    m_weights[static_cast<size_t>(TransferPriority::HIGH)] = 4;
+    m_weights[static_cast<size_t>(TransferPriority::NORMAL)] = 2;
+    m_weights[static_cast<size_t>(TransferPriority::BULK)] = 1;
+}
+
+void BandwidthLimiter::setMaxUploadBytesPerSecond(uint64_t newMaxUploadBytesPerSecond)
+{
+    m_maxBytesPerSecond[UPLOAD] = newMaxUploadBytesPerSecond;
+}
+
+void BandwidthLimiter::setMaxDownloadBytesPerSecond(uint64_t newMaxDownloadBytesPerSecond)
+{
+    m_maxBytesPerSecond[DOWNLOAD] = newMaxDownloadBytesPerSecond;
+}
+
+void BandwidthLimiter::setWeight(TransferPriority priority, unsigned int weight)
+{
+    m_weights.at(static_cast<size_t>(priority)) = std::max(weight, 1u);
+}
+
+void BandwidthLimiter::_addTransfer(CurlAsyncTransfer *transfer)
+{
+    if(m_transfers.emplace(transfer->curl().handle, TransferState{transfer, transfer->priority()}).second)
+        m_runningTransfers[static_cast<size_t>(transfer->priority())]++;
+}
+
+void BandwidthLimiter::_removeTransfer(CURL *handle)
+{
+    auto iter = m_transfers.find(handle);
+    if(iter == m_transfers.end())
+        return;
+
+    size_t priority = static_cast<size_t>(iter->second.priority);
+    m_runningTransfers[priority]--;
+    if(iter->second.transfer->_isPaused(PauseReason::BANDWIDTH_LIMIT))
+        m_pausedTransfers--;
+
+    // the debt of a priority without transfers is forgiven
+    if(m_runningTransfers[priority] == 0)
+        m_tokens[priority] = {};
+
+    m_transfers.erase(iter);
+}
+
+void BandwidthLimiter::_consume(CURL *handle, uint64_t uploadedBytes, uint64_t downloadedBytes)
+{
+    auto iter = m_transfers.find(handle);
+    if(iter == m_transfers.end())
+        return;
+
+    refill(std::chrono::steady_clock::now());
+
+    size_t priority = static_cast<size_t>(iter->second.priority);
+    m_tokens[priority][UPLOAD] -= uploadedBytes;
+    m_tokens[priority][DOWNLOAD] -= downloadedBytes;
+
+    if(!iter->second.transfer->_isPaused(PauseReason::BANDWIDTH_LIMIT) && overdrawn(priority))
+    {
+        if(iter->second.transfer->_pause(PauseReason::BANDWIDTH_LIMIT))
+            m_pausedTransfers++;
+    }
+}
+
+int BandwidthLimiter::_resumeTransfers()
+{
+    if(m_pausedTransfers == 0)
+        return -1;
+
+    refill(std::chrono::steady_clock::now());
+
+    double waitMs = -1.0;
+    for(auto &[handle, state] : m_transfers)
+    {
+        if(!state.transfer->_isPaused(PauseReason::BANDWIDTH_LIMIT))
+            continue;
+
+        size_t priority = static_cast<size_t>(state.priority);
+        if(!overdrawn(priority))
+        {
+            // Count it first: unpausing may deliver buffered data and consume again right away
+            m_pausedTransfers--;
+            state.transfer->_resume(PauseReason::BANDWIDTH_LIMIT); // a paused upload source keeps the upload paused
+            continue;
+        }
+
+        // wake up for the earliest transfer, which may continue; waiting longer would waste the tokens of the others
+        double transferWaitMs = 0.0;
+        for(Direction direction : {UPLOAD, DOWNLOAD})
+        {
+            double rate = ratePerPriority(direction, priority);
+            if((rate > 0.0) && (m_tokens[priority][direction] < 0.0))
+                transferWaitMs = std::max(transferWaitMs, -m_tokens[priority][direction] / rate * 1000.0);
+        }
+
+        if((waitMs < 0.0) || (transferWaitMs < waitMs))
+            waitMs = transferWaitMs;
+    }
+
+    if(m_pausedTransfers == 0)
+        return -1;
+
+    return std::max(1, static_cast<int>(std::ceil(waitMs)));
+}
+
+void BandwidthLimiter::refill(std::chrono::steady_clock::time_point now)
+{
+    std::chrono::duration<double> elapsed = now - m_lastRefill;
+    m_lastRefill = now;
+
+    for(size_t priority = 0; priority < transferPriorityCount; priority++)
+    {
+        if(m_runningTransfers[priority] == 0)
+            continue;
+
+        for(Direction direction : {UPLOAD, DOWNLOAD})
+        {
+            double rate = ratePerPriority(direction, priority);
+            if(rate <= 0.0)
+                continue;
+
+            double burst = std::max(rate * burstDuration_s, minBurst_bytes);
+            m_tokens[priority][direction] = std::min(m_tokens[priority][direction] + rate * elapsed.count(), burst);
+        }
+    }
+}
+
+double BandwidthLimiter::ratePerPriority(Direction direction, size_t priority) const
+{
+    uint64_t maxBytesPerSecond = m_maxBytesPerSecond[direction];
+    if(maxBytesPerSecond == 0)
+        return 0.0;
+
+    // only the priorities with running transfers share the rate, so no bandwidth is wasted on idle ones
+    unsigned int weightSum = 0;
+    for(size_t i = 0; i < transferPriorityCount; i++)
+    {
+        if(m_runningTransfers[i] > 0)
+            weightSum += m_weights[i];
+    }
+
+    if(weightSum == 0)
+        return 0.0;
+
+    return static_cast<double>(maxBytesPerSecond) * m_weights[priority] / weightSum;
+}
+
+bool BandwidthLimiter::overdrawn(size_t priority) const
+{
+    for(Direction direction : {UPLOAD, DOWNLOAD})
+    {
+        if((m_maxBytesPerSecond[direction] > 0) && (m_tokens[priority][direction] < 0.0))
+            return true;
+    }
+
+    return false;
+}
+
+}
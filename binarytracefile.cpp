@@ -0,0 +1,374 @@
+#include "libcurl-wrapper/binarytracefile.hpp"
+
+#include <fmt/core.h>
+
+#include <cstring>
+
+#ifdef LIBCURL_WRAPPER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace curl
+{
+
+namespace
+{
+
+constexpr char fileMagic[4] = {'C', 'T', 'B', '1'};
+constexpr uint32_t flagZstd = 1;
+constexpr size_t fileHeaderSize = 12;
+constexpr size_t blockHeaderSize = 8;
+constexpr size_t recordHeaderSize = BinaryTraceFile::recordHeaderSize;
+constexpr size_t blockSize = 64 * 1024;
+constexpr uint32_t maxStoredBlockSize = 256 * 1024 * 1024; // a corrupt length must not allocate gigabytes
+
+void appendU32(std::vector<char> &buffer, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+        buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+void storeU32(char *data, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void storeU64(char *data, uint64_t value)
+{
+    for(int i = 0; i < 8; i++)
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+uint32_t readU32(const char *data)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+uint64_t readU64(const char *data)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+}
+
+BinaryTraceFile::BinaryTraceFile(const cu::Logger &logger)
+    : m_logger(logger)
+{
+
+}
+
+BinaryTraceFile::~BinaryTraceFile()
+{
+    if(m_file.is_open())
+        finalize();
+}
+
+bool BinaryTraceFile::compressionSupported()
+{
+#ifdef LIBCURL_WRAPPER_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BinaryTraceFile::initialize()
+{
+    m_logger->info(fmt::format("create binary trace file: {}", m_filename));
+
+    m_file.open(m_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!m_file.is_open())
+    {
+        std::string errMsg = fmt::format("failed to open trace file {}", m_filename);
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    std::vector<char> header(fileMagic, fileMagic + sizeof(fileMagic));
+    appendU32(header, (m_enableCompression && compressionSupported()) ? flagZstd : 0);
+    appendU32(header, m_maxDataSize);
+    m_file.write(header.data(), header.size());
+
+    m_block.clear();
+    m_block.reserve(blockSize + recordHeaderSize);
+    m_timepointTransferBegin = std::chrono::steady_clock::now();
+}
+
+void BinaryTraceFile::finalize()
+{
+    writeBlock();
+    m_file.close();
+}
+
+void BinaryTraceFile::traceCurlDebugInfo([[maybe_unused]] CURL *handle, curl_infotype type, char *data, size_t size)
+{
+    TracePayload payload = TraceFile::tracePayload(type, size, m_enableSslData, m_maxDataSize, m_dataSize);
+    appendRecord(BinaryTraceRecordKind::CURL_DEBUG_INFO, type, payload, size, data, (payload == TracePayload::DATA) ? size : 0);
+}
+
+void BinaryTraceFile::traceMessage(std::string_view entry)
+{
+    appendRecord(BinaryTraceRecordKind::MESSAGE, CURLINFO_TEXT, TracePayload::DATA, entry.size(), entry.data(), entry.size());
+}
+
+void BinaryTraceFile::appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize)
+{
+    if(!m_file.is_open())
+        return;
+
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_timepointTransferBegin);
+
+    size_t offset = m_block.size();
+    m_block.resize(offset + recordHeaderSize);
+    encodeRecordHeader(m_block.data() + offset, kind, type, payload, size, time, m_transferId, dataSize);
+    m_block.insert(m_block.end(), data, data + dataSize);
+
+    if(m_block.size() >= blockSize)
+        writeBlock();
+}
+
+void BinaryTraceFile::appendEncodedRecords(const char *records, size_t size)
+{
+    if(!m_file.is_open())
+        return;
+
+    // Record by record, so the blocks keep their size
+    size_t offset = 0;
+    while(size - offset >= 4)
+    {
+        size_t recordSize = 4 + readU32(records + offset);
+        if(recordSize > size - offset)
+            break;
+
+        m_block.insert(m_block.end(), records + offset, records + offset + recordSize);
+        offset += recordSize;
+
+        if(m_block.size() >= blockSize)
+            writeBlock();
+    }
+}
+
+void BinaryTraceFile::encodeRecordHeader(char *header, BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size,
+                                         std::chrono::microseconds time, uint64_t transferId, size_t dataSize)
+{
+    storeU32(header, static_cast<uint32_t>(recordHeaderSize - 4 + dataSize));
+    header[4] = static_cast<char>(kind);
+    header[5] = static_cast<char>(type);
+    header[6] = static_cast<char>(payload);
+    header[7] = 0;
+    storeU32(header + 8, static_cast<uint32_t>(size));
+    storeU64(header + 12, static_cast<uint64_t>(time.count()));
+    storeU64(header + 20, transferId);
+}
+
+void BinaryTraceFile::writeBlock()
+{
+    if(m_block.empty() || !m_file.is_open())
+        return;
+
+    const char *stored = m_block.data();
+    size_t storedSize = m_block.size();
+
+#ifdef LIBCURL_WRAPPER_HAVE_ZSTD
+    if(m_enableCompression)
+    {
+        m_compressedBlock.resize(ZSTD_compressBound(m_block.size()));
+        size_t compressedSize = ZSTD_compress(m_compressedBlock.data(), m_compressedBlock.size(), m_block.data(), m_block.size(), 1);
+        if(ZSTD_isError(compressedSize))
+        {
+            // The flag in the file header can't be taken back: drop the block instead of writing a corrupt file
+            m_logger->error(fmt::format("failed to compress trace block: {}", ZSTD_getErrorName(compressedSize)));
+            m_block.clear();
+            return;
+        }
+
+        stored = m_compressedBlock.data();
+        storedSize = compressedSize;
+    }
+#endif
+
+    std::vector<char> header;
+    appendU32(header, static_cast<uint32_t>(m_block.size()));
+    appendU32(header, static_cast<uint32_t>(storedSize));
+    m_file.write(header.data(), header.size());
+    m_file.write(stored, storedSize);
+
+    m_block.clear();
+}
+
+const std::string &BinaryTraceFile::filename() const
+{
+    return m_filename;
+}
+
+void BinaryTraceFile::setFilename(const std::string &newFilename)
+{
+    m_filename = newFilename;
+}
+
+uint32_t BinaryTraceFile::maxDataSize() const
+{
+    return m_maxDataSize;
+}
+
+void BinaryTraceFile::setMaxDataSize(uint32_t newMaxDataSize)
+{
+    m_maxDataSize = newMaxDataSize;
+}
+
+void BinaryTraceFile::enableSslData(bool newEnableSslData)
+{
+    m_enableSslData = newEnableSslData;
+}
+
+void BinaryTraceFile::enableCompression(bool newEnableCompression)
+{
+    m_enableCompression = newEnableCompression && compressionSupported();
+}
+
+void BinaryTraceFile::setTransferId(uint64_t newTransferId)
+{
+    m_transferId = newTransferId;
+}
+
+BinaryTraceReader::BinaryTraceReader(const cu::Logger &logger)
+    : m_logger(logger)
+{
+
+}
+
+void BinaryTraceReader::open(const std::string &filename)
+{
+    m_filename = filename;
+    m_file.open(filename, std::ios::in | std::ios::binary);
+    if(!m_file.is_open())
+        fail("failed to open");
+
+    char header[fileHeaderSize];
+    if(!m_file.read(header, sizeof(header)) || (std::memcmp(header, fileMagic, sizeof(fileMagic)) != 0))
+        fail("not a binary trace file");
+
+    m_flags = readU32(header + 4);
+    m_maxDataSize = readU32(header + 8);
+
+    if((m_flags & flagZstd) && !BinaryTraceFile::compressionSupported())
+        fail("compressed with zstd, but libcurl-wrapper was built without zstd");
+
+    m_block.clear();
+    m_blockOffset = 0;
+}
+
+bool BinaryTraceReader::next(BinaryTraceRecord &record)
+{
+    while(m_blockOffset >= m_block.size())
+    {
+        if(!readBlock())
+            return false;
+    }
+
+    if(!decodeRecord(m_block.data(), m_block.size(), m_blockOffset, record))
+        fail("invalid record");
+
+    return true;
+}
+
+bool BinaryTraceReader::decodeRecord(const char *data, size_t size, size_t &offset, BinaryTraceRecord &record)
+{
+    if((offset > size) || (size - offset < recordHeaderSize))
+        return false;
+
+    const char *header = data + offset;
+    size_t length = readU32(header);
+    if((length < recordHeaderSize - 4) || (length > size - offset - 4))
+        return false;
+
+    record.kind = static_cast<BinaryTraceRecordKind>(header[4]);
+    record.type = static_cast<curl_infotype>(header[5]);
+    record.payload = static_cast<TracePayload>(header[6]);
+    record.size = readU32(header + 8);
+    record.time = std::chrono::microseconds(readU64(header + 12));
+    record.transferId = readU64(header + 20);
+    record.data.assign(header + recordHeaderSize, header + 4 + length);
+
+    offset += 4 + length;
+    return true;
+}
+
+uint32_t BinaryTraceReader::maxDataSize() const
+{
+    return m_maxDataSize;
+}
+
+void BinaryTraceReader::writeText(std::ostream &stream, BinaryTraceRecord &record) const
+{
+    writeText(stream, record, m_maxDataSize);
+}
+
+void BinaryTraceReader::writeText(std::ostream &stream, BinaryTraceRecord &record, uint32_t maxDataSize)
+{
+    if(record.kind == BinaryTraceRecordKind::MESSAGE)
+    {
+        stream.write(record.data.data(), record.data.size());
+        return;
+    }
+
+    TraceFile::writeCurlDebugInfo(stream, record.type, record.data.data(), record.size,
+                                  std::chrono::duration_cast<std::chrono::milliseconds>(record.time), record.payload, maxDataSize);
+}
+
+bool BinaryTraceReader::readBlock()
+{
+    char header[blockHeaderSize];
+    if(!m_file.read(header, sizeof(header)))
+    {
+        if(m_file.gcount() != 0)
+            fail("truncated block header");
+
+        return false;
+    }
+
+    uint32_t rawSize = readU32(header);
+    uint32_t storedSize = readU32(header + 4);
+    if((rawSize > maxStoredBlockSize) || (storedSize > maxStoredBlockSize))
+        fail("invalid block size");
+
+    m_storedBlock.resize(storedSize);
+    if(!m_file.read(m_storedBlock.data(), storedSize))
+        fail("truncated block");
+
+    if(m_flags & flagZstd)
+    {
+#ifdef LIBCURL_WRAPPER_HAVE_ZSTD
+        m_block.resize(rawSize);
+        size_t decompressedSize = ZSTD_decompress(m_block.data(), m_block.size(), m_storedBlock.data(), m_storedBlock.size());
+        if(ZSTD_isError(decompressedSize) || (decompressedSize != rawSize))
+            fail("failed to decompress block");
+#endif
+    }
+    else
+    {
+        if(storedSize != rawSize)
+            fail("invalid block size");
+
+        std::swap(m_block, m_storedBlock);
+    }
+
+    m_blockOffset = 0;
+    return true;
+}
+
+void BinaryTraceReader::fail(const std::string &message) const
+{
+    std::string errMsg = fmt::format("binary trace file {}: {}", m_filename, message);
+    m_logger->error(errMsg);
+    throw std::runtime_error(errMsg);
+}
+
+}
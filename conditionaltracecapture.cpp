@@ -0,0 +1,144 @@
+#include "libcurl-wrapper/conditionaltracecapture.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <random>
+
+namespace curl
+{
+
+bool TraceCapturePolicy::shouldCapture(AsyncResult asyncResult, CURLcode curlResult, long responseCode) const
+{
+    if(asyncResult == TIMEOUT)
+        return captureTimeouts;
+
+    if(asyncResult == CANCELED)
+        return captureCanceled;
+
+    if(captureCurlErrors && (curlResult != CURLE_OK))
+        return true;
+
+    if(captureServerErrors && (responseCode >= 500) && (responseCode < 600))
+        return true;
+
+    if(std::find(responseCodes.begin(), responseCodes.end(), responseCode) != responseCodes.end())
+        return true;
+
+    if(sampleRate > 0.0)
+    {
+        thread_local std::mt19937 randomEngine{std::random_device{}()};
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+        return distribution(randomEngine) < sampleRate;
+    }
+
+    return false;
+}
+
+ConditionalTraceCapture::ConditionalTraceCapture(const cu::Logger &logger, const TraceCapturePolicy &policy, TraceCaptureWriter writer)
+    : m_logger(logger),
+      m_policy(policy),
+      m_writer(std::move(writer))
+{
+
+}
+
+ConditionalTraceCapture::~ConditionalTraceCapture()
+{
+    finalize();
+}
+
+void ConditionalTraceCapture::initialize()
+{
+    m_records.clear();
+    m_droppedRecords = 0;
+    m_captured = false;
+    m_dataSize = 0;
+    m_timepointTransferBegin = std::chrono::steady_clock::now();
+}
+
+void ConditionalTraceCapture::transferFinished(CurlAsyncTransfer *transfer)
+{
+    m_captured = m_policy.shouldCapture(transfer->asyncResult(), transfer->curlResult(), transfer->responseCode());
+}
+
+void ConditionalTraceCapture::finalize()
+{
+    if(m_captured && m_writer)
+    {
+        if(m_droppedRecords > 0)
+        {
+            // Beyond the limit on purpose: the reader of the trace has to know, that it is incomplete
+            std::string message = fmt::format("### {} trace entries dropped, the capture buffer is full ###\n", m_droppedRecords);
+            encodeRecord(BinaryTraceRecordKind::MESSAGE, CURLINFO_TEXT, TracePayload::DATA, message.size(), message.data(), message.size());
+            m_droppedRecords = 0;
+        }
+
+        try
+        {
+            m_writer(m_transferId, m_maxDataSize, m_records);
+        }
+        catch(std::exception &e)
+        {
+            m_logger->error(fmt::format("failed to write the captured trace of transfer {}: {}", m_transferId, e.what()));
+        }
+    }
+
+    m_captured = false;
+    m_records.clear();
+}
+
+void ConditionalTraceCapture::traceCurlDebugInfo([[maybe_unused]] CURL *handle, curl_infotype type, char *data, size_t size)
+{
+    TracePayload payload = TraceFile::tracePayload(type, size, m_enableSslData, m_maxDataSize, m_dataSize);
+    appendRecord(BinaryTraceRecordKind::CURL_DEBUG_INFO, type, payload, size, data, (payload == TracePayload::DATA) ? size : 0);
+}
+
+void ConditionalTraceCapture::traceMessage(std::string_view entry)
+{
+    appendRecord(BinaryTraceRecordKind::MESSAGE, CURLINFO_TEXT, TracePayload::DATA, entry.size(), entry.data(), entry.size());
+}
+
+void ConditionalTraceCapture::appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize)
+{
+    size_t offset = m_records.size();
+    if((m_policy.maxBufferSize > 0) && (offset + BinaryTraceFile::recordHeaderSize + dataSize > m_policy.maxBufferSize))
+    {
+        m_droppedRecords++;
+        return;
+    }
+
+    encodeRecord(kind, type, payload, size, data, dataSize);
+}
+
+void ConditionalTraceCapture::encodeRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize)
+{
+    size_t offset = m_records.size();
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_timepointTransferBegin);
+
+    m_records.resize(offset + BinaryTraceFile::recordHeaderSize);
+    BinaryTraceFile::encodeRecordHeader(m_records.data() + offset, kind, type, payload, size, time, m_transferId, dataSize);
+    m_records.insert(m_records.end(), data, data + dataSize);
+}
+
+uint32_t ConditionalTraceCapture::maxDataSize() const
+{
+    return m_maxDataSize;
+}
+
+void ConditionalTraceCapture::setMaxDataSize(uint32_t newMaxDataSize)
+{
+    m_maxDataSize = newMaxDataSize;
+}
+
+void ConditionalTraceCapture::enableSslData(bool newEnableSslData)
+{
+    m_enableSslData = newEnableSslData;
+}
+
+void ConditionalTraceCapture::setTransferId(uint64_t newTransferId)
+{
+    m_transferId = newTransferId;
+}
+
+}
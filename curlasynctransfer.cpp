@@ -1,13 +1,24 @@
 #include "libcurl-wrapper/curlasynctransfer.hpp"
+#include "libcurl-wrapper/bandwidthlimiter.hpp"
 #include "cpp-utils/timeutils.hpp"
 
 #include <fmt/core.h>
 
+#include <atomic>
+
 namespace curl
 {
 
+namespace
+{
+
+std::atomic<uint64_t> nextTransferId{1};
+
+}
+
 CurlAsyncTransfer::CurlAsyncTransfer(const cu::Logger &logger)
-    : m_logger(logger)
+    : m_logger(logger),
+      m_transferId(nextTransferId++)
 {
 }
 
@@ -16,9 +27,20 @@ const CurlHolder &CurlAsyncTransfer::curl() const
     return m_curl;
 }
 
+uint64_t CurlAsyncTransfer::transferId() const
+{
+    return m_transferId;
+}
+
 void CurlAsyncTransfer::setUrl(const std::string &url)
 {
-    curl_easy_setopt(m_curl.handle, CURLOPT_URL, url.c_str());
+    m_url = url;
+    curl_easy_setopt(m_curl.handle, CURLOPT_URL, m_url.c_str());
+}
+
+const std::string &CurlAsyncTransfer::url() const
+{
+    return m_url;
 }
 
 void CurlAsyncTransfer::setVerifySslCertificates(bool doVerifySslCertificates)
@@ -44,6 +66,16 @@ void CurlAsyncTransfer::setReuseExistingConnection(bool doReuseExistingConnectio
         curl_easy_setopt(m_curl.handle, CURLOPT_FORBID_REUSE, 1L);
 }
 
+TransferPriority CurlAsyncTransfer::priority() const
+{
+    return m_priority;
+}
+
+void CurlAsyncTransfer::setPriority(TransferPriority newPriority)
+{
+    m_priority = newPriority;
+}
+
 void CurlAsyncTransfer::setTransferCallback(const TransferCallback &newTransferCallback)
 {
     m_transferCallback = newTransferCallback;
@@ -74,6 +106,31 @@ long CurlAsyncTransfer::responseCode() const
     return m_responseCode;
 }
 
+void CurlAsyncTransfer::setMaxUploadSpeed_BytesPerSecond(uint64_t maxUploadSpeed)
+{
+    curl_easy_setopt(m_curl.handle, CURLOPT_MAX_SEND_SPEED_LARGE, static_cast<curl_off_t>(maxUploadSpeed));
+}
+
+void CurlAsyncTransfer::setMaxDownloadSpeed_BytesPerSecond(uint64_t maxDownloadSpeed)
+{
+    curl_easy_setopt(m_curl.handle, CURLOPT_MAX_RECV_SPEED_LARGE, static_cast<curl_off_t>(maxDownloadSpeed));
+}
+
+std::shared_ptr<RetryPolicy> CurlAsyncTransfer::retryPolicy() const
+{
+    return m_retryPolicy;
+}
+
+void CurlAsyncTransfer::setRetryPolicy(std::shared_ptr<RetryPolicy> newRetryPolicy)
+{
+    m_retryPolicy = std::move(newRetryPolicy);
+}
+
+unsigned int CurlAsyncTransfer::attempts() const
+{
+    return m_attempts;
+}
+
 unsigned int CurlAsyncTransfer::progressTimeout_s() const
 {
     return m_progressTimeout_s;
@@ -119,15 +176,31 @@ void CurlAsyncTransfer::_prepareTransfer()
     m_downloadedBytes = 0;
     m_transferSpeed_BytesPerSecond = 0;
     m_transferredBytesLastProgress = 0;
+    m_consumedUploadBytes = 0;
+    m_consumedDownloadBytes = 0;
+    m_pausedByLimiter = false;
+    m_pausedBySource = false;
 
     m_responseCode = -1;
+    m_curlResult = CURL_LAST;
+    m_attempts++;
     m_asyncResult = RUNNING;
     m_timepointTransferBegin = std::chrono::steady_clock::now();
+
+    m_transferTimings = TransferTimings();
+    if(m_timepointQueued != std::chrono::steady_clock::time_point()) // not set without CurlMultiAsync
+        m_transferTimings.queueWait = std::chrono::duration_cast<std::chrono::microseconds>(m_timepointTransferBegin - m_timepointQueued);
     m_timepointLastProgressLogEntry = m_timepointTransferBegin;
     m_timepointLastProgress = m_timepointTransferBegin;
 }
 
 void CurlAsyncTransfer::_processResponse(AsyncResult asyncResult, CURLcode curlResult)
+{
+    _finishTransfer(asyncResult, curlResult);
+    _completeTransfer();
+}
+
+void CurlAsyncTransfer::_finishTransfer(AsyncResult asyncResult, CURLcode curlResult)
 {
     m_curlResult = curlResult;
 
@@ -148,9 +221,26 @@ void CurlAsyncTransfer::_processResponse(AsyncResult asyncResult, CURLcode curlR
     curl_easy_getinfo(m_curl.handle, CURLINFO_SPEED_DOWNLOAD_T, &downloadSpeed);
     m_transferSpeed_BytesPerSecond = std::max(uploadSpeed, downloadSpeed);
 
+    auto getTime = [this](CURLINFO info)
+    {
+        curl_off_t time_us = 0;
+        if(curl_easy_getinfo(m_curl.handle, info, &time_us) != CURLE_OK)
+            time_us = 0;
+        return std::chrono::microseconds(time_us);
+    };
+
+    m_transferTimings.nameLookup = getTime(CURLINFO_NAMELOOKUP_TIME_T);
+    m_transferTimings.connect = getTime(CURLINFO_CONNECT_TIME_T);
+    m_transferTimings.appConnect = getTime(CURLINFO_APPCONNECT_TIME_T);
+    m_transferTimings.preTransfer = getTime(CURLINFO_PRETRANSFER_TIME_T);
+    m_transferTimings.startTransfer = getTime(CURLINFO_STARTTRANSFER_TIME_T);
+    m_transferTimings.total = getTime(CURLINFO_TOTAL_TIME_T);
+    m_transferTimings.redirect = getTime(CURLINFO_REDIRECT_TIME_T);
+
     if(m_tracing)
     {
         m_tracing->traceMessage(fmt::format("### Response Code: {} ###\n", m_responseCode));
+        m_tracing->transferFinished(this);
         m_tracing->finalize();
         m_tracing.reset(); // do not overwrite the trace file if the transfer object is reused
     }
@@ -159,10 +249,135 @@ void CurlAsyncTransfer::_processResponse(AsyncResult asyncResult, CURLcode curlR
     std::chrono::duration<float> diff = now - m_timepointTransferBegin;
     m_transferDuration_s = diff.count();
 
-    processResponse();
+    finishTransfer();
+}
+
+void CurlAsyncTransfer::_completeTransfer()
+{
+    // Take the handler first: it may hand the transfer back to another thread, which submits it again
+    CompletionHandler completionHandler = std::move(m_completionHandler);
+    m_completionHandler = nullptr;
 
-    if(m_transferCallback)
-        m_transferCallback(this);
+    try
+    {
+        processResponse();
+
+        if(m_transferCallback)
+            m_transferCallback(this);
+    }
+    catch(...)
+    {
+        if(completionHandler)
+            completionHandler(m_asyncResult);
+        throw;
+    }
+
+    if(completionHandler)
+        completionHandler(m_asyncResult);
+}
+
+void CurlAsyncTransfer::_setTimepointQueued(std::chrono::steady_clock::time_point timepointQueued)
+{
+    m_timepointQueued = timepointQueued;
+}
+
+void CurlAsyncTransfer::_resetAttempts()
+{
+    m_attempts = 0;
+}
+
+std::chrono::steady_clock::time_point CurlAsyncTransfer::timepointQueued() const
+{
+    return m_timepointQueued;
+}
+
+void CurlAsyncTransfer::_setCompletionHandler(const CompletionHandler &completionHandler)
+{
+    if(m_completionHandler)
+    {
+        std::string errMsg = "transfer is already pending";
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    m_completionHandler = completionHandler;
+}
+
+bool CurlAsyncTransfer::copyForHedging(CurlAsyncTransfer &hedge) const
+{
+    // curl_easy_duphandle() copies all options, so we don't have to remember them; the callbacks are redirected by _prepareTransfer()
+    if(!hedge.m_curl.duplicate(m_curl))
+    {
+        m_logger->error("curl_easy_duphandle() failed");
+        return false;
+    }
+
+    hedge.m_url = m_url;
+    hedge.m_priority = m_priority;
+    hedge.m_progressTimeout_s = m_progressTimeout_s;
+    hedge.m_maxTransferDuration_s = m_maxTransferDuration_s;
+    hedge.m_logPrefix = m_logPrefix;
+    return true;
+}
+
+void CurlAsyncTransfer::_adoptHedge(CurlAsyncTransfer &hedge)
+{
+    // With the handle of the winner curl_easy_getinfo() reports its connection, and so does _finishTransfer()
+    m_curl.swap(hedge.m_curl);
+    m_asyncResult = hedge.m_asyncResult; // a timeout of the failed original must not stick
+    m_downloadedBytes = hedge.m_downloadedBytes;
+    m_uploadededBytes = hedge.m_uploadededBytes;
+}
+
+void CurlAsyncTransfer::_setBandwidthLimiter(BandwidthLimiter *bandwidthLimiter)
+{
+    m_bandwidthLimiter = bandwidthLimiter;
+}
+
+bool CurlAsyncTransfer::_pause(PauseReason reason)
+{
+    if(reason == PauseReason::UPLOAD_SOURCE)
+    {
+        m_pausedBySource = true; // libcurl pauses the upload itself, when the read callback returns CURL_READFUNC_PAUSE
+        return true;
+    }
+
+    // allowed from within the callbacks of the transfer
+    if(curl_easy_pause(m_curl.handle, CURLPAUSE_ALL) != CURLE_OK)
+        return false;
+
+    m_pausedByLimiter = true;
+    return true;
+}
+
+void CurlAsyncTransfer::_resume(PauseReason reason)
+{
+    // Cleared first: unpausing may deliver buffered data and pause the transfer again right away
+    if(reason == PauseReason::UPLOAD_SOURCE)
+        m_pausedBySource = false;
+    else
+        m_pausedByLimiter = false;
+
+    if(m_pausedByLimiter)
+        return;
+
+    // Without data from the source only the download may continue
+    curl_easy_pause(m_curl.handle, m_pausedBySource ? CURLPAUSE_SEND : CURLPAUSE_CONT);
+}
+
+bool CurlAsyncTransfer::_isPaused(PauseReason reason) const
+{
+    return (reason == PauseReason::UPLOAD_SOURCE) ? m_pausedBySource : m_pausedByLimiter;
+}
+
+void CurlAsyncTransfer::consumeBandwidth(uint64_t uploadedBytes, uint64_t downloadedBytes)
+{
+    if(!m_bandwidthLimiter || ((uploadedBytes == 0) && (downloadedBytes == 0)))
+        return;
+
+    m_consumedUploadBytes += uploadedBytes;
+    m_consumedDownloadBytes += downloadedBytes;
+    m_bandwidthLimiter->_consume(m_curl.handle, uploadedBytes, downloadedBytes);
 }
 
 size_t CurlAsyncTransfer::staticOnProgressCallback(void *token, curl_off_t downloadTotal, curl_off_t downloadNow, curl_off_t uploadTotal, curl_off_t uploadNow)
@@ -182,6 +397,13 @@ size_t CurlAsyncTransfer::onProgressCallback([[maybe_unused]] curl_off_t downloa
     {
         // we have real progress
         m_timepointLastProgress = now;
+
+        if(m_bandwidthLimiter)
+        {
+            uint64_t uploaded = static_cast<uint64_t>(uploadNow), downloaded = static_cast<uint64_t>(downloadNow);
+            consumeBandwidth(uploaded > m_consumedUploadBytes ? uploaded - m_consumedUploadBytes : 0,
+                             downloaded > m_consumedDownloadBytes ? downloaded - m_consumedDownloadBytes : 0);
+        }
     }
 
     if(m_progressLogging_s > 0)
@@ -262,6 +484,11 @@ void CurlAsyncTransfer::setProgressLogging_s(unsigned int newProgressLogging_s)
     m_progressLogging_s = newProgressLogging_s;
 }
 
+const TransferTimings &CurlAsyncTransfer::transferTimings() const
+{
+    return m_transferTimings;
+}
+
 uint64_t CurlAsyncTransfer::transferSpeed_BytesPerSecond() const
 {
     return m_transferSpeed_BytesPerSecond;
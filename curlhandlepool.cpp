@@ -0,0 +1,125 @@
+#include "libcurl-wrapper/curlhandlepool.hpp"
+
+namespace curl
+{
+
+CurlHandlePool &CurlHandlePool::instance()
+{
+    // Avoids initalization order problems
+    static CurlHandlePool curlHandlePool;
+    return curlHandlePool;
+}
+
+CurlHandlePool::~CurlHandlePool()
+{
+    clear();
+}
+
+CURL *CurlHandlePool::acquire()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_handles.empty())
+        {
+            CURL *handle = m_handles.back();
+            m_handles.pop_back();
+            m_reuses++;
+            return handle;
+        }
+    }
+
+    return createHandle();
+}
+
+void CurlHandlePool::release(CURL *handle)
+{
+    if(handle == nullptr)
+        return;
+
+    // Only handles, which fit into the pool, are reset
+    bool reserved = false;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_handles.size() + m_reservedSlots < m_maxSize)
+        {
+            m_reservedSlots++;
+            reserved = true;
+        }
+    }
+
+    if(reserved)
+    {
+        // Reset outside of the lock: this may take a moment
+        curl_easy_reset(handle);
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_reservedSlots--;
+        if(m_handles.size() < m_maxSize) // setMaxSize() may have shrunk the pool meanwhile
+        {
+            m_handles.push_back(handle);
+            m_releases++;
+            return;
+        }
+    }
+
+    curl_easy_cleanup(handle);
+    m_cleanups++;
+}
+
+size_t CurlHandlePool::maxSize() const
+{
+    return m_maxSize;
+}
+
+void CurlHandlePool::setMaxSize(size_t newMaxSize)
+{
+    m_maxSize = newMaxSize;
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    while(m_handles.size() > m_maxSize)
+    {
+        curl_easy_cleanup(m_handles.back());
+        m_handles.pop_back();
+        m_cleanups++;
+    }
+}
+
+void CurlHandlePool::clear()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    for(CURL *handle : m_handles)
+    {
+        curl_easy_cleanup(handle);
+        m_cleanups++;
+    }
+    m_handles.clear();
+}
+
+CurlHandlePoolStatistics CurlHandlePool::statistics() const
+{
+    CurlHandlePoolStatistics statistics;
+    statistics.easyInits = m_easyInits;
+    statistics.reuses    = m_reuses;
+    statistics.releases  = m_releases;
+    statistics.cleanups  = m_cleanups;
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    statistics.pooledHandles = m_handles.size();
+    return statistics;
+}
+
+CURL *CurlHandlePool::createHandle()
+{
+    // Allow multithreaded access by locking curl_easy_init().
+    // curl_easy_init() is not thread safe.
+    // References:
+    // https://curl.haxx.se/libcurl/c/curl_easy_init.html
+    // https://curl.haxx.se/libcurl/c/threadsafe.html
+    static std::mutex curl_easy_init_mutex;
+
+    const std::lock_guard<std::mutex> lock(curl_easy_init_mutex);
+    m_easyInits++;
+    return curl_easy_init();
+}
+
+}
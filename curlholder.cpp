@@ -1,35 +1,40 @@
 #include "libcurl-wrapper/curlholder.hpp"
+#include "libcurl-wrapper/curlhandlepool.hpp"
 
 #include <cassert>
+#include <utility>
 
 namespace curl
 {
 
 CurlHolder::CurlHolder()
 {
-    // Allow multithreaded access by locking curl_easy_init().
-    // curl_easy_init() is not thread safe.
-    // References:
-    // https://curl.haxx.se/libcurl/c/curl_easy_init.html
-    // https://curl.haxx.se/libcurl/c/threadsafe.html
-
-    curl_easy_init_mutex().lock();
-    handle = curl_easy_init();
-    curl_easy_init_mutex().unlock();
+    // The pool falls back to curl_easy_init(), which it serializes, because curl_easy_init() is not thread safe
+    handle = CurlHandlePool::instance().acquire();
     assert(handle);
 }
 
 CurlHolder::~CurlHolder()
 {
-    curl_easy_cleanup(handle);
+    CurlHandlePool::instance().release(handle); // resets the handle, so it no longer refers to requestHeader
     curl_slist_free_all(requestHeader);
 }
 
-std::mutex &CurlHolder::curl_easy_init_mutex()
+bool CurlHolder::duplicate(const CurlHolder &other)
 {
-    // Avoids initalization order problems
-    static std::mutex curl_easy_init_mutex;
-    return curl_easy_init_mutex;
+    CURL *copy = curl_easy_duphandle(other.handle);
+    if(copy == nullptr)
+        return false;
+
+    CurlHandlePool::instance().release(handle);
+    handle = copy;
+    return true;
+}
+
+void CurlHolder::swap(CurlHolder &other)
+{
+    std::swap(handle, other.handle);
+    std::swap(requestHeader, other.requestHeader);
 }
 
 }
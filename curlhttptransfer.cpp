@@ -3,33 +3,32 @@
 
 #include <fmt/ostream.h>
 
-#include <regex>
+#include <algorithm>
+#include <charconv>
 
 namespace curl
 {
 
+namespace
+{
+
+// A larger Content-Length is not trusted: the buffer grows while the data arrives
+constexpr size_t maxReservedResponseSize = 16 * 1024 * 1024;
+
+}
+
 CurlHttpTransfer::CurlHttpTransfer(const cu::Logger &logger)
     : CurlAsyncTransfer(logger)
 {
 
 }
 
-std::string CurlHttpTransfer::responseHeader(const std::string &headerName)
+std::string_view CurlHttpTransfer::responseHeader(std::string_view headerName) const
 {
-    auto header = cu::simpleCase(headerName);
-    try
-    {
-        return m_responseHeaders.at(header);
-    }
-    catch(std::out_of_range &e)
-    {
-        m_logger->warning(fmt::format("header {} does not exist", header));
-    }
-
-    return "";
+    return m_responseHeaders.value(headerName);
 }
 
-std::unordered_map<std::string, std::string> &CurlHttpTransfer::responseHeaders()
+const HttpHeaders &CurlHttpTransfer::responseHeaders() const
 {
     return m_responseHeaders;
 }
@@ -44,6 +43,11 @@ void CurlHttpTransfer::setOutputFilename(const std::string &fileNameWithPath)
     m_outputFileName = fileNameWithPath;
 }
 
+void CurlHttpTransfer::setResponseSink(std::shared_ptr<ResponseSink> newResponseSink)
+{
+    m_responseSink = std::move(newResponseSink);
+}
+
 void CurlHttpTransfer::setHeader(const std::string &name, const std::string &content)
 {
     auto headerName = cu::simpleCase(name);
@@ -62,6 +66,8 @@ void CurlHttpTransfer::setUploadFilename(const std::string &fileNameWithPath)
 
 void CurlHttpTransfer::setPostData(const char *data, long size, bool copyData)
 {
+    m_hasPostData = true;
+
     if(size != -1)
         curl_easy_setopt(m_curl.handle, CURLOPT_POSTFIELDSIZE, size);
 
@@ -71,6 +77,50 @@ void CurlHttpTransfer::setPostData(const char *data, long size, bool copyData)
         curl_easy_setopt(m_curl.handle, CURLOPT_POSTFIELDS, data);
 }
 
+void CurlHttpTransfer::setUploadSource(std::shared_ptr<UploadSource> newUploadSource)
+{
+    m_uploadSource = std::move(newUploadSource);
+}
+
+bool CurlHttpTransfer::isIdempotent() const
+{
+    return !m_hasPostData && m_uploadFileName.empty() && !m_uploadSource;
+}
+
+std::chrono::milliseconds CurlHttpTransfer::retryAfter() const
+{
+    std::string_view value = m_responseHeaders.value("Retry-After");
+
+    unsigned int seconds = 0;
+    if(value.empty() || (std::from_chars(value.data(), value.data() + value.size(), seconds).ec != std::errc()))
+        return std::chrono::milliseconds(0);
+
+    return std::chrono::seconds(seconds);
+}
+
+std::shared_ptr<CurlAsyncTransfer> CurlHttpTransfer::_cloneForHedging() const
+{
+    if(!isIdempotent() || m_responseSink || !m_outputFileName.empty())
+        return nullptr;
+
+    auto hedge = std::make_shared<CurlHttpTransfer>(m_logger);
+    if(!copyForHedging(*hedge))
+        return nullptr;
+
+    hedge->m_requestHeaders = m_requestHeaders;
+    hedge->m_followRedirects = m_followRedirects;
+    return hedge;
+}
+
+void CurlHttpTransfer::_adoptHedge(CurlAsyncTransfer &hedge)
+{
+    CurlAsyncTransfer::_adoptHedge(hedge);
+
+    auto &httpHedge = static_cast<CurlHttpTransfer&>(hedge); // created by _cloneForHedging()
+    std::swap(m_responseHeaders, httpHedge.m_responseHeaders);
+    std::swap(m_responseData, httpHedge.m_responseData);
+}
+
 void CurlHttpTransfer::prepareTransfer()
 {
     curl_easy_setopt(m_curl.handle, CURLOPT_WRITEDATA, this);
@@ -82,7 +132,19 @@ void CurlHttpTransfer::prepareTransfer()
     m_responseHeaders.clear();
     m_responseData.clear();
 
-    if(!m_outputFileName.empty())
+    // A retried attempt skips processResponse(): start over with the files of the failed one
+    if(m_outputFile.is_open())
+        m_outputFile.close();
+
+    if(m_uploadFileHandle != nullptr)
+    {
+        fclose(m_uploadFileHandle);
+        m_uploadFileHandle = nullptr;
+    }
+
+    if(m_responseSink)
+        m_responseSink->begin();
+    else if(!m_outputFileName.empty())
     {
         m_outputFile.open(m_outputFileName, std::ios::out | std::ios::binary | std::ios::trunc);
         if(!m_outputFile.is_open())
@@ -93,7 +155,24 @@ void CurlHttpTransfer::prepareTransfer()
         }
     }
 
-    if(!m_uploadFileName.empty())
+    if(m_uploadSource)
+    {
+        if(!m_uploadSource->rewind())
+        {
+            std::string errMsg = "upload source can't be sent again";
+            m_logger->error(errMsg);
+            throw std::runtime_error(errMsg);
+        }
+
+        curl_easy_setopt(m_curl.handle, CURLOPT_POST, 1L);
+        curl_easy_setopt(m_curl.handle, CURLOPT_POSTFIELDS, nullptr);
+        curl_easy_setopt(m_curl.handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(m_uploadSource->size())); // -1: chunked
+        curl_easy_setopt(m_curl.handle, CURLOPT_READDATA, this);
+        curl_easy_setopt(m_curl.handle, CURLOPT_READFUNCTION, &staticOnReadCallback);
+        curl_easy_setopt(m_curl.handle, CURLOPT_SEEKDATA, this);
+        curl_easy_setopt(m_curl.handle, CURLOPT_SEEKFUNCTION, &staticOnSeekCallback);
+    }
+    else if(!m_uploadFileName.empty())
     {
         m_uploadFileHandle = std::fopen(m_uploadFileName.c_str(), "r");
         if(m_uploadFileHandle == nullptr)
@@ -106,6 +185,7 @@ void CurlHttpTransfer::prepareTransfer()
         curl_easy_setopt(m_curl.handle, CURLOPT_POST, 1L);
         curl_easy_setopt(m_curl.handle, CURLOPT_READDATA, m_uploadFileHandle);
         curl_easy_setopt(m_curl.handle, CURLOPT_READFUNCTION , nullptr);
+        curl_easy_setopt(m_curl.handle, CURLOPT_SEEKFUNCTION , nullptr);
         // If you set this callback pointer to NULL, or do not set it at all, the default internal read function will be used.
         // It is doing an fread() on the FILE * userdata set with CURLOPT_READDATA.
     }
@@ -137,8 +217,20 @@ void CurlHttpTransfer::prepareTransfer()
         curl_easy_setopt(m_curl.handle, CURLOPT_FOLLOWLOCATION, 0L);
 }
 
+void CurlHttpTransfer::finishTransfer()
+{
+    // No more headers will arrive: afterwards the lookups of other threads don't modify the headers anymore
+    m_responseHeaders.buildIndex();
+}
+
 void CurlHttpTransfer::processResponse()
 {
+    if(m_responseSink)
+        m_responseSink->end();
+
+    if(m_uploadSource)
+        m_uploadSource->end();
+
     if(m_outputFile.is_open())
         m_outputFile.close();
 
@@ -154,23 +246,37 @@ size_t CurlHttpTransfer::staticOnWriteCallback(const char *ptr, size_t size, siz
     size_t realsize = size * nmemb;
 
     if(token != nullptr)
-        static_cast<CurlHttpTransfer*>(token)->onWriteCallback(ptr, realsize);
+    {
+        if(!static_cast<CurlHttpTransfer*>(token)->onWriteCallback(ptr, realsize))
+            return 0; // aborts the transfer with CURLE_WRITE_ERROR
+    }
 
     return realsize;
 }
 
-void CurlHttpTransfer::onWriteCallback(const char *ptr, size_t realsize)
+bool CurlHttpTransfer::onWriteCallback(const char *ptr, size_t realsize)
 {
     if((ptr == nullptr) || (realsize == 0))
     {
             m_logger->warning("write: no data");
-            return;
+            return true;
     }
 
-    if(m_outputFile.is_open())
+    if(m_responseSink)
+    {
+        if(!m_responseSink->write(ptr, realsize))
+        {
+            m_logger->error(fmt::format("{}response sink refused {} bytes", m_logPrefix, realsize));
+            return false;
+        }
+    }
+    else if(m_outputFile.is_open())
         m_outputFile.write(ptr, realsize);
     else
         m_responseData.insert(m_responseData.end(), ptr, ptr + realsize);
+
+    consumeBandwidth(0, realsize);
+    return true;
 }
 
 size_t CurlHttpTransfer::staticOnHeaderCallback(const char *buffer, size_t size, size_t nitems, void *token)
@@ -193,53 +299,115 @@ void CurlHttpTransfer::onHeaderCallback(const char *buffer, size_t realsize)
             return;
     }
 
-    std::string header{buffer, realsize};
-    cu::trim(header);
-
-    if(header.size() == 0)
-        return;
+    std::string_view line{buffer, realsize};
+    std::string_view headerName;
+    std::string_view headerValue;
 
-    auto const regexSplit = std::regex(R"(([\w-]+): *([[:print:]]+))");
-    std::smatch matches;
-    if(std::regex_search(header, matches, regexSplit))
+    if(parseHeaderLine(line, headerName, headerValue))
     {
-        if(matches.size() == 3)
-        {
-            auto headerName = cu::simpleCase(matches[1].str());
-            auto headerValue = matches[2].str();
-            m_responseHeaders[headerName] = headerValue;
+        m_responseHeaders.add(headerName, headerValue);
 
-            if(headerName == "Content-Length")
+        if(equalsIgnoreCase(headerName, "Content-Length"))
+        {
+            size_t length = 0;
+            auto [end, ec] = std::from_chars(headerValue.data(), headerValue.data() + headerValue.size(), length);
+            if((ec != std::errc()) || (end != headerValue.data() + headerValue.size()))
+                m_logger->error(fmt::format("failed to parse Content-Length: {}", headerValue));
+            else if(length > 0)
             {
+                // The value comes from the server and no exception may pass through libcurl
                 try
                 {
-                    auto length = stol(headerValue);
-                    if(length > 0)
-                    {
-                        m_responseData.reserve(length);
-                    }
+                    if(m_responseSink)
+                        m_responseSink->sizeHint(length);
+                    else
+                        m_responseData.reserve(std::min(length, maxReservedResponseSize));
                 }
                 catch(const std::exception &e)
                 {
-                    m_logger->error(fmt::format("failed to parse Content-Length: {} => {} ", headerValue, e.what()));
+                    m_logger->error(fmt::format("failed to reserve Content-Length: {} => {} ", headerValue, e.what()));
                 }
             }
         }
     }
     else
     {
-        if(header.rfind("HTTP", 0) == 0)
+        std::string_view httpVersion;
+        if(parseStatusLine(line, httpVersion))
         {
-            std::istringstream iss(header);
-            std::vector<std::string> results(std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>());
-            m_responseHeaders["HTTP-Version"] = results.at(0);
+            // a new response begins (after a redirect or "100 Continue"): only keep the headers of the final one
+            m_responseHeaders.clear();
+            m_responseHeaders.add("HTTP-Version", httpVersion);
         }
     }
 }
 
+size_t CurlHttpTransfer::staticOnReadCallback(char *buffer, size_t size, size_t nitems, void *token)
+{
+    if(token == nullptr)
+        return CURL_READFUNC_ABORT;
+
+    return static_cast<CurlHttpTransfer*>(token)->onReadCallback(buffer, size * nitems);
+}
+
+size_t CurlHttpTransfer::onReadCallback(char *buffer, size_t capacity)
+{
+    if(!m_uploadSource)
+        return CURL_READFUNC_ABORT;
+
+    size_t bytes = m_uploadSource->read(buffer, capacity);
+    if((bytes == UploadSource::readPause) || (bytes == UploadSource::readAbort))
+    {
+        if(bytes == UploadSource::readAbort)
+            m_logger->error(fmt::format("{}upload source aborted the transfer", m_logPrefix));
+        else
+            _pause(PauseReason::UPLOAD_SOURCE);
+
+        return bytes;
+    }
+
+    if(bytes > capacity)
+    {
+        m_logger->error(fmt::format("{}upload source returned {} bytes for a buffer of {} bytes", m_logPrefix, bytes, capacity));
+        return CURL_READFUNC_ABORT;
+    }
+
+    consumeBandwidth(bytes, 0);
+    return bytes;
+}
+
+int CurlHttpTransfer::staticOnSeekCallback(void *token, curl_off_t offset, int origin)
+{
+    // libcurl only seeks to resend the whole body, e.g. after a redirect
+    if((token == nullptr) || (offset != 0) || (origin != SEEK_SET))
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    auto transfer = static_cast<CurlHttpTransfer*>(token);
+    if(!transfer->m_uploadSource || !transfer->m_uploadSource->rewind())
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    return CURL_SEEKFUNC_OK;
+}
+
 void CurlHttpTransfer::setFollowRedirects(bool newFollowRedirects)
 {
     m_followRedirects = newFollowRedirects;
 }
 
+void CurlHttpTransfer::setHttpVersion(HttpVersion httpVersion)
+{
+    long curlHttpVersion = CURL_HTTP_VERSION_NONE;
+
+    switch(httpVersion)
+    {
+    case HttpVersion::DEFAULT:                curlHttpVersion = CURL_HTTP_VERSION_NONE; break;
+    case HttpVersion::HTTP_1_1:               curlHttpVersion = CURL_HTTP_VERSION_1_1; break;
+    case HttpVersion::HTTP_2:                 curlHttpVersion = CURL_HTTP_VERSION_2_0; break;
+    case HttpVersion::HTTP_2_TLS:             curlHttpVersion = CURL_HTTP_VERSION_2TLS; break;
+    case HttpVersion::HTTP_2_PRIOR_KNOWLEDGE: curlHttpVersion = CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE; break;
+    }
+
+    curl_easy_setopt(m_curl.handle, CURLOPT_HTTP_VERSION, curlHttpVersion);
+}
+
 }
@@ -1,19 +1,46 @@
 #include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/curlurl.hpp"
 
 #include <fmt/core.h>
 
 #include <algorithm>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 namespace curl
 {
 
-CurlMultiAsync::CurlMultiAsync(const cu::Logger &logger)
-    : m_logger(logger)
+CurlMultiAsync::CurlMultiAsync(const cu::Logger &logger, EventLoop eventLoop, CompletionMode completionMode)
+    : m_logger(logger),
+      m_eventLoop(eventLoop),
+      m_completionMode(completionMode)
 {
-    m_multiHandle = curl_multi_init();
+    if(m_eventLoop == EventLoop::SOCKET_ACTION)
+        createEventLoopDescriptors();
 
-    if(m_multiHandle == NULL)
+    if(m_completionMode == CompletionMode::QUEUED)
     {
+        m_completionFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(m_completionFd == -1)
+        {
+            closeEventLoopDescriptors();
+
+            std::string errMsg = fmt::format("failed to create eventfd: {}", std::strerror(errno));
+            m_logger->error(errMsg);
+            throw std::runtime_error(errMsg);
+        }
+    }
+
+    if(!initializeMultiStack())
+    {
+        closeEventLoopDescriptors();
+        if(m_completionFd != -1)
+            close(m_completionFd);
+
         std::string errMsg = "curl_multi_init() failed !!!";
         m_logger->error(errMsg);
         throw std::runtime_error(errMsg);
@@ -25,20 +52,51 @@ CurlMultiAsync::CurlMultiAsync(const cu::Logger &logger)
 CurlMultiAsync::~CurlMultiAsync()
 {
     m_threadKeepRunning = false;
+    wakeupEventLoop();
     m_thread->join();
 
-    cancelAllTransfers();
+    // The thread has finished, so we can cancel the remaining transfers right here.
+    // This also detaches them from the share, which may outlive this object.
+    m_cancelAllTransfers = true;
+    handleQueues();
+
+    // Nobody may drain them after this: complete the queued transfers here, so all callbacks and futures fire
+    if(m_completionMode == CompletionMode::QUEUED)
+    {
+        drainCompletions();
+        close(m_completionFd);
+    }
+
     curl_multi_cleanup(m_multiHandle);
+    closeEventLoopDescriptors();
 }
 
 void CurlMultiAsync::performTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
 {
+    m_activeTransferCount++;
+    transfer->_setTimepointQueued(std::chrono::steady_clock::now());
+    transfer->_resetAttempts();
+    m_priorityStatistics[static_cast<size_t>(transfer->priority())].queuedTransfers++;
+
     const std::lock_guard<std::mutex> lock(m_queueMutex);
     m_incomingTransfers.push(transfer);
 
-    // Wake up a blocking curl_multi_poll() call
-    // This is the ONLY function on CURLM handles, that is safe to call concurrently from another thread (or even multiple threads)
-    curl_multi_wakeup(m_multiHandle);
+    wakeupEventLoop();
+}
+
+std::future<AsyncResult> CurlMultiAsync::performTransferAsync(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    // std::function must be copyable, std::promise isn't
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    std::future<AsyncResult> future = promise->get_future();
+
+    transfer->_setCompletionHandler([promise](AsyncResult asyncResult)
+    {
+        promise->set_value(asyncResult);
+    });
+
+    performTransfer(transfer);
+    return future;
 }
 
 void CurlMultiAsync::cancelTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
@@ -46,41 +104,156 @@ void CurlMultiAsync::cancelTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
     const std::lock_guard<std::mutex> lock(m_queueMutex);
     m_eleminatingTransfers.push(transfer);
 
-    // Wake up a blocking curl_multi_poll() call
-    // This is the ONLY function on CURLM handles, that is safe to call concurrently from another thread (or even multiple threads)
-    curl_multi_wakeup(m_multiHandle);
+    wakeupEventLoop();
+}
+
+void CurlMultiAsync::resumeTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    // curl_easy_pause() must not run concurrently with a perform pass, so the thread resumes it
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_resumingTransfers.push_back(std::move(transfer));
+
+    wakeupEventLoop();
+}
+
+void CurlMultiAsync::performTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers)
+{
+    if(transfers.empty())
+        return;
+
+    m_activeTransferCount += transfers.size();
+
+    auto now = std::chrono::steady_clock::now();
+    for(const auto &transfer : transfers)
+    {
+        transfer->_setTimepointQueued(now);
+        transfer->_resetAttempts();
+        m_priorityStatistics[static_cast<size_t>(transfer->priority())].queuedTransfers++;
+    }
+
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    for(const auto &transfer : transfers)
+        m_incomingTransfers.push(transfer);
+
+    wakeupEventLoop();
+}
+
+void CurlMultiAsync::cancelTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers)
+{
+    if(transfers.empty())
+        return;
+
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    for(const auto &transfer : transfers)
+        m_eleminatingTransfers.push(transfer);
+
+    wakeupEventLoop();
 }
 
 void CurlMultiAsync::cancelAllTransfers()
 {
     m_cancelAllTransfers = true;
+
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    wakeupEventLoop();
 }
 
 void CurlMultiAsync::waitForCompletion()
 {
-    for(;;)
-    {
-        if(m_incomingTransfers.empty() && m_runningTransfers.empty()) // TODO: do we need a mutex here?
-            return;
+    waitForCompletion(Deadline::max());
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+bool CurlMultiAsync::waitForCompletion(Deadline deadline)
+{
+    return waitUntil(deadline, [this]() { return m_activeTransferCount == 0; });
 }
 
-bool CurlMultiAsync::waitForStarted(uint32_t timeoutMs)
+bool CurlMultiAsync::waitForAnyCompletion(Deadline deadline)
 {
-    uint32_t elapsedMs = 0;
+    return waitForCompletedTransfers(m_completedTransferCount + 1, deadline);
+}
+
+bool CurlMultiAsync::waitForCompletedTransfers(uint64_t count, Deadline deadline)
+{
+    return waitUntil(deadline, [this, count]() { return m_completedTransferCount >= count; });
+}
+
+uint64_t CurlMultiAsync::completedTransfers() const
+{
+    return m_completedTransferCount;
+}
+
+int CurlMultiAsync::completionFd() const
+{
+    return m_completionFd;
+}
+
+size_t CurlMultiAsync::drainCompletions(size_t maxCompletions)
+{
+    std::vector<std::shared_ptr<CurlAsyncTransfer>> completions;
 
-    while(elapsedMs < timeoutMs)
     {
-        if(!m_runningTransfers.empty()) // TODO: do we need a mutex here?
-            return true;
+        const std::lock_guard<std::mutex> lock(m_completionMutex);
+        while(!m_completions.empty() && (completions.size() < maxCompletions))
+        {
+            completions.push_back(std::move(m_completions.front()));
+            m_completions.pop();
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        elapsedMs += 100;
+        // Reset the eventfd under the lock, so it can't swallow the signal of a completion queued in between
+        if(m_completions.empty() && (m_completionFd != -1))
+        {
+            uint64_t value;
+            [[maybe_unused]] auto bytesRead = read(m_completionFd, &value, sizeof(value));
+        }
     }
 
-    return false;
+    for(const auto &transfer : completions)
+    {
+        // One failing callback must not lose the rest of the batch
+        try
+        {
+            transfer->_completeTransfer();
+        }
+        catch(std::exception& e)
+        {
+             m_logger->error(fmt::format("C++ exception occurred: {}", e.what()));
+        }
+        catch(...)
+        {
+            m_logger->error("C++ exception occurred: unknown exception class");
+        }
+
+        transferCompleted();
+    }
+
+    return completions.size();
+}
+
+size_t CurlMultiAsync::queuedCompletions() const
+{
+    const std::lock_guard<std::mutex> lock(m_completionMutex);
+    return m_completions.size();
+}
+
+size_t CurlMultiAsync::activeTransfers() const
+{
+    return m_activeTransferCount;
+}
+
+size_t CurlMultiAsync::runningTransfers() const
+{
+    return m_runningTransferCount;
+}
+
+bool CurlMultiAsync::waitForStarted(Deadline deadline)
+{
+    return waitUntil(deadline, [this]() { return m_runningTransferCount > 0; });
+}
+
+bool CurlMultiAsync::waitForStarted(uint32_t timeoutMs)
+{
+    return waitForStarted(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
 }
 
 void CurlMultiAsync::threadedFunction()
@@ -89,8 +262,10 @@ void CurlMultiAsync::threadedFunction()
     {
         try
         {
-            if(m_runningTransfers.empty())
-                handleQueues();
+            handleQueues();
+
+            if(m_eventLoop == EventLoop::SOCKET_ACTION)
+                handleSocketActionTransfers();
             else
                 handleMultiStackTransfers();
         }
@@ -102,125 +277,724 @@ void CurlMultiAsync::threadedFunction()
         {
             m_logger->error("C++ exception occurred: unknown exception class");
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     m_logger->debug("thread finished");
 }
 
-void CurlMultiAsync::handleQueues()
+bool CurlMultiAsync::initializeMultiStack()
 {
-    std::shared_ptr<CurlAsyncTransfer> transfer;
+    m_multiHandle = curl_multi_init();
+    if(m_multiHandle == NULL)
+        return false;
 
-    while((transfer = getNextIncomingTransfer()))
+    if(m_eventLoop == EventLoop::SOCKET_ACTION)
     {
-        if(m_traceConfiguration)
-            m_traceConfiguration->configureTracing(transfer);
+        curl_multi_setopt(m_multiHandle, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(m_multiHandle, CURLMOPT_SOCKETFUNCTION, &staticOnSocketCallback);
+        curl_multi_setopt(m_multiHandle, CURLMOPT_TIMERDATA, this);
+        curl_multi_setopt(m_multiHandle, CURLMOPT_TIMERFUNCTION, &staticOnTimerCallback);
+    }
 
-        transfer->_prepareTransfer();
-        CURLMcode mc = curl_multi_add_handle(m_multiHandle, transfer->curl().handle);
-        if(mc != 0)
+    applyConnectionPolicy();
+    return true;
+}
+
+void CurlMultiAsync::applyConnectionPolicy()
+{
+    const auto &policy = m_appliedConnectionPolicy;
+
+    curl_multi_setopt(m_multiHandle, CURLMOPT_PIPELINING, policy.multiplex ? static_cast<long>(CURLPIPE_MULTIPLEX) : static_cast<long>(CURLPIPE_NOTHING));
+    curl_multi_setopt(m_multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, policy.maxHostConnections);
+    curl_multi_setopt(m_multiHandle, CURLMOPT_MAX_TOTAL_CONNECTIONS, policy.maxTotalConnections);
+    curl_multi_setopt(m_multiHandle, CURLMOPT_MAXCONNECTS, policy.maxCachedConnections); // always set: 0 restores libcurl's default
+}
+
+void CurlMultiAsync::createEventLoopDescriptors()
+{
+    m_epollFd  = epoll_create1(EPOLL_CLOEXEC);
+    m_timerFd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if((m_epollFd == -1) || (m_timerFd == -1) || (m_wakeupFd == -1))
+    {
+        closeEventLoopDescriptors();
+
+        std::string errMsg = fmt::format("failed to create epoll/timerfd/eventfd: {}", std::strerror(errno));
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    for(int fd : {m_timerFd, m_wakeupFd})
+    {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void CurlMultiAsync::closeEventLoopDescriptors()
+{
+    for(int *fd : {&m_epollFd, &m_timerFd, &m_wakeupFd})
+    {
+        if(*fd != -1)
         {
-            m_logger->error(fmt::format("curl_multi_add_handle error {}", static_cast<int>(mc)));
-            transfer->_processResponse(CANCELED, CURL_LAST);
-            return;
+            close(*fd);
+            *fd = -1;
         }
+    }
+}
 
-        m_runningTransfers.emplace_back(std::move(transfer));
+void CurlMultiAsync::wakeupEventLoop()
+{
+    if(m_eventLoop == EventLoop::SOCKET_ACTION)
+    {
+        uint64_t value = 1;
+        [[maybe_unused]] auto written = write(m_wakeupFd, &value, sizeof(value)); // EAGAIN means there is already a wakeup pending
     }
+    else
+    {
+        // Wake up a blocking curl_multi_poll() call
+        // This is the ONLY function on CURLM handles, that is safe to call concurrently from another thread (or even multiple threads)
+        curl_multi_wakeup(m_multiHandle);
+    }
+}
 
-    while((transfer = getNextEleminatingTransfer()))
+void CurlMultiAsync::handleQueues()
+{
     {
-        removeTransferFromRunningTransfers(transfer->curl().handle);
-        transfer->_processResponse(CANCELED, CURL_LAST);
-        curl_multi_remove_handle(m_multiHandle, transfer->curl().handle);
+        // Take over the queues as a whole: producers only ever wait for this swap, never for the transfers below or a perform pass
+        const std::lock_guard<std::mutex> lock(m_queueMutex);
+        std::swap(m_incomingTransfers, m_takenIncomingTransfers);
+        std::swap(m_eleminatingTransfers, m_takenEleminatingTransfers);
+        std::swap(m_resumingTransfers, m_takenResumingTransfers);
+
+        // curl_multi_setopt() must not run concurrently with a perform pass, so only this thread applies it
+        if(m_connectionPolicyChanged)
+        {
+            m_appliedConnectionPolicy = m_connectionPolicy;
+            m_connectionPolicyChanged = false;
+            applyConnectionPolicy();
+        }
     }
 
+    std::shared_ptr<CurlAsyncTransfer> transfer;
+
+    while(!m_takenIncomingTransfers.empty())
+    {
+        transfer = std::move(m_takenIncomingTransfers.front());
+        m_takenIncomingTransfers.pop();
+
+        std::string host;
+        if(m_maxTransfersPerHost > 0)
+            host = Url(transfer->url()).host();
+
+        m_pendingTransfers[static_cast<size_t>(transfer->priority())].push_back(PendingTransfer{std::move(transfer), std::move(host)});
+    }
+
+    while(!m_takenEleminatingTransfers.empty())
+    {
+        transfer = std::move(m_takenEleminatingTransfers.front());
+        m_takenEleminatingTransfers.pop();
+
+        if(cancelPendingTransfer(transfer))
+            continue;
+
+        // A failed original waits for its hedge: canceling the hedge completes the original as canceled
+        if(m_failedOriginals.count(transfer.get()) > 0)
+            transfer = m_hedges.at(transfer.get());
+
+        // CurlMultiAsyncPool forwards cancel requests to all of its stacks, so the transfer is not necessarily ours
+        if(!removeTransferFromRunningTransfers(transfer->curl().handle))
+            continue;
+
+        removeHandleFromMultiStack(transfer->curl().handle);
+        finishTransfer(transfer, CANCELED, CURL_LAST);
+    }
+
+    // A paused upload is continued after the perform pass, in which its source had no data: no resume request gets lost
+    for(auto &resumingTransfer : m_takenResumingTransfers)
+    {
+        auto transferIterator = m_runningTransfers.find(resumingTransfer->curl().handle);
+        if((transferIterator != m_runningTransfers.end()) && (transferIterator->second == resumingTransfer))
+            resumingTransfer->_resume(PauseReason::UPLOAD_SOURCE); // stays paused, while the BandwidthLimiter holds it
+    }
+    m_takenResumingTransfers.clear();
+
     if(m_cancelAllTransfers)
     {
         m_cancelAllTransfers = false;
 
+        for(auto &pendingTransfers : m_pendingTransfers)
+        {
+            while(!pendingTransfers.empty())
+            {
+                transfer = std::move(pendingTransfers.front().transfer);
+                pendingTransfers.pop_front();
+
+                m_priorityStatistics[static_cast<size_t>(transfer->priority())].queuedTransfers--;
+                finishTransfer(transfer, CANCELED, CURL_LAST);
+            }
+        }
+
+        // Move the heap away first: finishing the transfers must not find them scheduled
+        std::vector<ScheduledRetry> scheduledRetries;
+        std::swap(scheduledRetries, m_scheduledRetries);
+        m_retryStatistics.scheduledRetries = 0;
+        for(auto &scheduledRetry : scheduledRetries)
+            finishTransfer(scheduledRetry.transfer, CANCELED, CURL_LAST);
+
         auto transferIterator = m_runningTransfers.begin();
         while(transferIterator != m_runningTransfers.end())
         {
-            (*transferIterator)->_processResponse(CANCELED, CURL_LAST);
-            curl_multi_remove_handle(m_multiHandle, (*transferIterator)->curl().handle);
+            removeHandleFromMultiStack(transferIterator->first);
+            finishTransfer(transferIterator->second, CANCELED, CURL_LAST);
             transferIterator = m_runningTransfers.erase(transferIterator); // erase will increment the iterator
         }
+        m_runningTransferCount = 0;
+        m_runningTransferHosts.clear();
+        m_hostTransferCounts.clear();
     }
+
+    queueDueRetries();
+    admitPendingTransfers();
+    startDueHedges(); // after the admission: pending transfers get the free slots first
 }
 
-void CurlMultiAsync::handleMultiStackTransfers()
+void CurlMultiAsync::admitPendingTransfers()
 {
-    int transfersRunning = 1;
-    while(transfersRunning)
-    {
-        handleQueues();
+    bool startedTransfers = false;
 
-        CURLMcode mc;
+    // Strict priority: a lower priority only gets a slot, if no transfer of a higher priority can use it
+    for(auto &pendingTransfers : m_pendingTransfers)
+    {
+        auto pendingIterator = pendingTransfers.begin();
+        while(pendingIterator != pendingTransfers.end())
         {
-            const std::lock_guard<std::mutex> lock(m_queueMutex);
+            if((m_maxRunningTransfers > 0) && (m_runningTransfers.size() >= m_maxRunningTransfers))
+                break;
 
-            mc = curl_multi_perform(m_multiHandle, &transfersRunning);
-            if(mc != 0)
+            if(!pendingIterator->host.empty())
             {
-                m_logger->error(fmt::format("curl_multi_poll error {}", static_cast<int>(mc)));
-                restartMultiStack();
+                auto hostIterator = m_hostTransferCounts.find(pendingIterator->host);
+                if((hostIterator != m_hostTransferCounts.end()) && (hostIterator->second >= m_maxTransfersPerHost))
+                {
+                    pendingIterator++; // this host is busy, but the next transfer may go somewhere else
+                    continue;
+                }
             }
+
+            PendingTransfer pendingTransfer = std::move(*pendingIterator);
+            pendingIterator = pendingTransfers.erase(pendingIterator);
+
+            auto &statistics = m_priorityStatistics[static_cast<size_t>(pendingTransfer.transfer->priority())];
+            uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pendingTransfer.transfer->timepointQueued()).count();
+            statistics.queuedTransfers--;
+            statistics.admittedTransfers++;
+            statistics.totalWait_us += wait_us;
+            if(wait_us > statistics.maxWait_us) // only written by this thread
+                statistics.maxWait_us = wait_us;
+
+            if(startTransfer(std::move(pendingTransfer.transfer), std::move(pendingTransfer.host)))
+                startedTransfers = true;
+        }
+    }
+
+    if(startedTransfers)
+        notifyWaiters(); // for waitForStarted()
+}
+
+bool CurlMultiAsync::startTransfer(std::shared_ptr<CurlAsyncTransfer> transfer, std::string host)
+{
+    // The copies of hedged transfers are counted in the HedgingStatistics, never traced and never hedged themselves:
+    // the trace of a canceled loser would use up the trace quota and flood a conditional capture
+    bool isHedge = (m_hedgeOrigins.count(transfer.get()) > 0);
+
+    if(m_traceConfiguration && !isHedge)
+        m_traceConfiguration->configureTracing(transfer);
+
+    try
+    {
+        transfer->_prepareTransfer();
+    }
+    catch(std::exception& e)
+    {
+        m_logger->error(fmt::format("C++ exception occurred: {}", e.what()));
+
+        if(transfer->asyncResult() == RUNNING) // performTransfer() was called twice for the same transfer: keep the running one untouched
+        {
+            m_activeTransferCount--;
+            notifyWaiters();
         }
+        else
+            finishTransfer(transfer, CANCELED, CURL_LAST);
+
+        return false;
+    }
+
+    if(m_share)
+        curl_easy_setopt(transfer->curl().handle, CURLOPT_SHARE, m_share->handle());
+
+    // Always set: the transfer may have run on another CurlMultiAsync before
+    curl_easy_setopt(transfer->curl().handle, CURLOPT_PIPEWAIT, m_appliedConnectionPolicy.pipeWait ? 1L : 0L);
+    transfer->_setBandwidthLimiter(m_bandwidthLimiter.get());
+    if(m_bandwidthLimiter)
+        m_bandwidthLimiter->_addTransfer(transfer.get());
 
-        handleMultiStackMessages();
+    CURLMcode mc = curl_multi_add_handle(m_multiHandle, transfer->curl().handle);
+    if(mc != 0)
+    {
+        m_logger->error(fmt::format("curl_multi_add_handle error {}", static_cast<int>(mc)));
+        if(m_share)
+            curl_easy_setopt(transfer->curl().handle, CURLOPT_SHARE, nullptr);
+        if(m_bandwidthLimiter)
+            m_bandwidthLimiter->_removeTransfer(transfer->curl().handle);
+
+        finishTransfer(transfer, CANCELED, CURL_LAST);
+        return false;
+    }
+
+    if(!isHedge)
+        m_retryStatistics.attempts++;
+
+    if(m_hedgingPolicy && !isHedge)
+        scheduleHedge(transfer, host);
+
+    CURL *handle = transfer->curl().handle;
+    m_runningTransfers.emplace(handle, std::move(transfer));
+    m_runningTransferCount = m_runningTransfers.size();
+
+    if(!host.empty())
+    {
+        m_hostTransferCounts[host]++;
+        m_runningTransferHosts.emplace(handle, std::move(host));
+    }
+
+    return true;
+}
+
+bool CurlMultiAsync::cancelPendingTransfer(const std::shared_ptr<CurlAsyncTransfer> &transfer)
+{
+    auto &pendingTransfers = m_pendingTransfers[static_cast<size_t>(transfer->priority())];
+
+    auto pendingIterator = std::find_if(pendingTransfers.begin(), pendingTransfers.end(),
+                                        [&transfer](const PendingTransfer &pendingTransfer) { return pendingTransfer.transfer == transfer; });
+    if(pendingIterator == pendingTransfers.end())
+    {
+        auto retryIterator = std::find_if(m_scheduledRetries.begin(), m_scheduledRetries.end(),
+                                          [&transfer](const ScheduledRetry &scheduledRetry) { return scheduledRetry.transfer == transfer; });
+        if(retryIterator == m_scheduledRetries.end())
+            return false;
 
-        if(transfersRunning)
+        m_scheduledRetries.erase(retryIterator);
+        std::make_heap(m_scheduledRetries.begin(), m_scheduledRetries.end(), std::greater<>());
+        m_retryStatistics.scheduledRetries = m_scheduledRetries.size();
+        finishTransfer(transfer, CANCELED, CURL_LAST);
+        return true;
+    }
+
+    pendingTransfers.erase(pendingIterator);
+    m_priorityStatistics[static_cast<size_t>(transfer->priority())].queuedTransfers--;
+    finishTransfer(transfer, CANCELED, CURL_LAST);
+    return true;
+}
+
+bool CurlMultiAsync::scheduleRetry(const std::shared_ptr<CurlAsyncTransfer> &transfer)
+{
+    auto retryPolicy = transfer->retryPolicy();
+    if(!retryPolicy)
+        return false;
+
+    if(!retryPolicy->shouldRetry(*transfer))
+    {
+        if(retryPolicy->isRetryable(*transfer))
         {
-            mc = curl_multi_poll(m_multiHandle, NULL, 0, 1000, NULL);
-            if(mc != 0)
-            {
-                m_logger->error(fmt::format("curl_multi_poll error {}", static_cast<int>(mc)));
-                restartMultiStack();
-            }
+            if(transfer->attempts() >= retryPolicy->maxAttempts())
+                m_retryStatistics.exhaustedTransfers++;
+            else
+                m_retryStatistics.nonIdempotentFailures++;
+        }
+        else if((transfer->attempts() > 1) && (transfer->asyncResult() != CANCELED))
+            m_retryStatistics.recoveredTransfers++;
+
+        return false;
+    }
+
+    auto delay = retryPolicy->retryDelay(*transfer);
+    m_logger->info(fmt::format("attempt {} of {} to {} failed (result {}, curl {}, response {}): retrying in {} ms", transfer->attempts(), retryPolicy->maxAttempts(),
+                               transfer->url(), static_cast<int>(transfer->asyncResult()), static_cast<int>(transfer->curlResult()), transfer->responseCode(), delay.count()));
+
+    m_scheduledRetries.push_back(ScheduledRetry{std::chrono::steady_clock::now() + delay, transfer});
+    std::push_heap(m_scheduledRetries.begin(), m_scheduledRetries.end(), std::greater<>());
+    m_retryStatistics.retries++;
+    m_retryStatistics.scheduledRetries = m_scheduledRetries.size();
+    return true;
+}
+
+void CurlMultiAsync::queueDueRetries()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    // The retries go through the admission queues again, so they respect the limits and priorities like new transfers
+    while(!m_scheduledRetries.empty() && (m_scheduledRetries.front().due <= now))
+    {
+        std::pop_heap(m_scheduledRetries.begin(), m_scheduledRetries.end(), std::greater<>());
+        std::shared_ptr<CurlAsyncTransfer> transfer = std::move(m_scheduledRetries.back().transfer);
+        m_scheduledRetries.pop_back();
+
+        transfer->_setTimepointQueued(now);
+        m_priorityStatistics[static_cast<size_t>(transfer->priority())].queuedTransfers++;
+
+        std::string host;
+        if(m_maxTransfersPerHost > 0)
+            host = Url(transfer->url()).host();
+
+        m_pendingTransfers[static_cast<size_t>(transfer->priority())].push_back(PendingTransfer{std::move(transfer), std::move(host)});
+    }
+
+    m_retryStatistics.scheduledRetries = m_scheduledRetries.size();
+}
+
+void CurlMultiAsync::scheduleHedge(const std::shared_ptr<CurlAsyncTransfer> &transfer, const std::string &host)
+{
+    if(!transfer->isIdempotent())
+        return;
+
+    auto histogramIterator = m_hostLatencies.find(host.empty() ? Url(transfer->url()).host() : host);
+    if(histogramIterator == m_hostLatencies.end())
+        return;
+
+    std::chrono::microseconds delay;
+    if(!m_hedgingPolicy->hedgeDelay(histogramIterator->second, delay))
+        return;
+
+    // Finished transfers are not searched in the heap: their entry is simply ignored, once it is due
+    uint64_t sequence = ++m_hedgeSequence;
+    m_hedgeCandidates[transfer.get()] = sequence;
+    m_scheduledHedges.push_back(ScheduledHedge{std::chrono::steady_clock::now() + delay, transfer, sequence});
+    std::push_heap(m_scheduledHedges.begin(), m_scheduledHedges.end(), std::greater<>());
+}
+
+void CurlMultiAsync::startDueHedges()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    while(!m_scheduledHedges.empty() && (m_scheduledHedges.front().due <= now))
+    {
+        std::pop_heap(m_scheduledHedges.begin(), m_scheduledHedges.end(), std::greater<>());
+        ScheduledHedge scheduledHedge = std::move(m_scheduledHedges.back());
+        m_scheduledHedges.pop_back();
+
+        auto candidateIterator = m_hedgeCandidates.find(scheduledHedge.transfer.get());
+        if((candidateIterator == m_hedgeCandidates.end()) || (candidateIterator->second != scheduledHedge.sequence))
+            continue; // finished in time
+        m_hedgeCandidates.erase(candidateIterator);
+
+        const auto &original = scheduledHedge.transfer;
+
+        std::string host;
+        if(m_maxTransfersPerHost > 0)
+            host = Url(original->url()).host();
+
+        // A hedge adds load: it has to respect the limits like any other transfer
+        auto hostIterator = m_hostTransferCounts.find(host);
+        if(((m_maxRunningTransfers > 0) && (m_runningTransfers.size() >= m_maxRunningTransfers)) ||
+           ((hostIterator != m_hostTransferCounts.end()) && (hostIterator->second >= m_maxTransfersPerHost)))
+        {
+            m_hedgingStatistics.skippedHedges++;
+            continue;
+        }
+
+        auto hedge = original->_cloneForHedging();
+        if(!hedge)
+            continue;
+
+        m_hedges[original.get()] = hedge;
+        m_hedgeOrigins[hedge.get()] = original;
+        m_hedgingStatistics.hedgedTransfers++;
+
+        startTransfer(std::move(hedge), std::move(host)); // if it fails, finishTransfer() drops the copy
+    }
+}
+
+bool CurlMultiAsync::resolveHedge(const std::shared_ptr<CurlAsyncTransfer> &transfer, AsyncResult asyncResult, CURLcode curlResult)
+{
+    m_hedgeCandidates.erase(transfer.get()); // finished before its hedge was due
+
+    auto originIterator = m_hedgeOrigins.find(transfer.get());
+    if(originIterator != m_hedgeOrigins.end())
+    {
+        std::shared_ptr<CurlAsyncTransfer> original = std::move(originIterator->second);
+        m_hedgeOrigins.erase(originIterator);
+        m_hedges.erase(original.get());
+        bool originalFailed = (m_failedOriginals.erase(original.get()) > 0);
+        bool hedgeSucceeded = (asyncResult == CURL_DONE) && (curlResult == CURLE_OK);
+
+        // Finalizes the trace of the copy; its callbacks never run
+        transfer->_finishTransfer(asyncResult, curlResult);
+
+        // A failed or canceled copy is simply dropped, while the original keeps running
+        if(!hedgeSucceeded && !originalFailed)
+            return true;
+
+        // The copy was faster: cancel the original like cancelTransfer() does, but complete it with the result of the copy
+        if(!originalFailed && removeTransferFromRunningTransfers(original->curl().handle))
+            removeHandleFromMultiStack(original->curl().handle);
+
+        original->_adoptHedge(*transfer);
+        if(hedgeSucceeded)
+            m_hedgingStatistics.hedgeWins++;
+
+        finishTransfer(original, asyncResult, curlResult);
+        return true;
+    }
+
+    auto hedgeIterator = m_hedges.find(transfer.get());
+    if(hedgeIterator != m_hedges.end())
+    {
+        // The copy may still succeed: a failed original waits for it, instead of delivering the failure
+        if((asyncResult != CANCELED) && (curlResult != CURLE_OK))
+        {
+            m_failedOriginals.insert(transfer.get());
+            return true;
         }
+
+        std::shared_ptr<CurlAsyncTransfer> hedge = hedgeIterator->second;
+        cancelRunningHedge(hedge);
+    }
+
+    return false;
+}
+
+void CurlMultiAsync::cancelRunningHedge(const std::shared_ptr<CurlAsyncTransfer> &hedge)
+{
+    // Like cancelTransfer(): finishTransfer() finalizes the copy and drops it
+    if(!removeTransferFromRunningTransfers(hedge->curl().handle))
+        return;
+
+    removeHandleFromMultiStack(hedge->curl().handle);
+    finishTransfer(hedge, CANCELED, CURL_LAST);
+}
+
+void CurlMultiAsync::recordLatency(CURL *handle, const CurlAsyncTransfer &transfer)
+{
+    curl_off_t totalTime_us;
+    if(curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &totalTime_us) != CURLE_OK)
+        return;
+
+    m_hostLatencies[Url(transfer.url()).host()].record(std::chrono::microseconds(totalTime_us));
+}
+
+void CurlMultiAsync::handleMultiStackTransfers()
+{
+    int transfersRunning = 0;
+
+    // Must not hold m_queueMutex here: curl_multi_perform() runs all write, header and progress callbacks
+    CURLMcode mc = curl_multi_perform(m_multiHandle, &transfersRunning);
+    if(mc != 0)
+    {
+        m_logger->error(fmt::format("curl_multi_perform error {}", static_cast<int>(mc)));
+        restartMultiStack();
+        return;
+    }
+
+    handleMultiStackMessages();
+
+    // The loop is purely event driven: we only block here until there is socket activity, a libcurl timeout expires
+    // or curl_multi_wakeup() is called by performTransfer(), cancelTransfer() or the destructor.
+    // curl_multi_poll() limits the timeout on its own, if libcurl needs to be called earlier (e.g. for the progress callback).
+    mc = curl_multi_poll(m_multiHandle, NULL, 0, eventLoopTimeoutMs(), NULL);
+    if(mc != 0)
+    {
+        m_logger->error(fmt::format("curl_multi_poll error {}", static_cast<int>(mc)));
+        restartMultiStack();
     }
 }
 
+void CurlMultiAsync::handleSocketActionTransfers()
+{
+    constexpr int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+
+    // libcurl tells us about its sockets and timeouts by staticOnSocketCallback() and staticOnTimerCallback(),
+    // so epoll_wait() only reports the sockets with activity and we never have to walk all transfers.
+    int eventCount = epoll_wait(m_epollFd, events, maxEvents, eventLoopTimeoutMs());
+    if(eventCount == -1)
+    {
+        if(errno != EINTR)
+            m_logger->error(fmt::format("epoll_wait error {}", std::strerror(errno)));
+
+        return;
+    }
+
+    int transfersRunning = 0;
+    for(int i = 0; i < eventCount; i++)
+    {
+        CURLMcode mc = CURLM_OK;
+        int fd = events[i].data.fd;
+
+        if(fd == m_wakeupFd)
+        {
+            uint64_t value;
+            [[maybe_unused]] auto bytesRead = read(m_wakeupFd, &value, sizeof(value));
+        }
+        else if(fd == m_timerFd)
+        {
+            uint64_t expirations;
+            [[maybe_unused]] auto bytesRead = read(m_timerFd, &expirations, sizeof(expirations));
+            mc = curl_multi_socket_action(m_multiHandle, CURL_SOCKET_TIMEOUT, 0, &transfersRunning);
+        }
+        else
+        {
+            int flags = 0;
+            if(events[i].events & EPOLLIN)
+                flags |= CURL_CSELECT_IN;
+            if(events[i].events & EPOLLOUT)
+                flags |= CURL_CSELECT_OUT;
+            if(events[i].events & (EPOLLERR | EPOLLHUP))
+                flags |= CURL_CSELECT_ERR;
+
+            mc = curl_multi_socket_action(m_multiHandle, fd, flags, &transfersRunning);
+        }
+
+        if(mc != CURLM_OK)
+        {
+            m_logger->error(fmt::format("curl_multi_socket_action error {}", static_cast<int>(mc)));
+            restartMultiStack();
+            return;
+        }
+    }
+
+    handleMultiStackMessages();
+}
+
 void CurlMultiAsync::handleMultiStackMessages()
 {
     CURLMsg *curlMessage;
     int messagesLeft;
 
+    // Collect all messages before removing any handle: curl_multi_remove_handle() searches the list of pending messages,
+    // so interleaving both calls would make the completion of N transfers O(N^2).
+    m_finishedHandles.clear();
     while((curlMessage = curl_multi_info_read(m_multiHandle, &messagesLeft)))
     {
         if(curlMessage->msg == CURLMSG_DONE)
+            m_finishedHandles.emplace_back(curlMessage->easy_handle, curlMessage->data.result);
+        else
         {
-            auto asyncTransfer = removeTransferFromRunningTransfers(curlMessage->easy_handle);
+            // Until now, there are no other msg types defined in libcurl
+            m_logger->warning(fmt::format("got unknown message {} from handle {}", static_cast<int>(curlMessage->msg), curlMessage->easy_handle));
+        }
+    }
 
-            if(asyncTransfer)
-                asyncTransfer->_processResponse(CURL_DONE, curlMessage->data.result);
-            else
-                m_logger->debug(fmt::format("transfer missing {}", curlMessage->easy_handle));
+    for(const auto& [handle, curlResult] : m_finishedHandles)
+    {
+        auto asyncTransfer = removeTransferFromRunningTransfers(handle);
+        if(!asyncTransfer && m_hedgingPolicy)
+            continue; // the loser of a hedged transfer, which finished in the same pass as the winner: already removed
+
+        if(m_share)
+            m_share->recordTransfer(handle);
+
+        removeHandleFromMultiStack(handle);
+
+        if(asyncTransfer)
+        {
+            if(m_hedgingPolicy && (curlResult == CURLE_OK))
+                recordLatency(handle, *asyncTransfer);
 
-            curl_multi_remove_handle(m_multiHandle, curlMessage->easy_handle);
-            // WARNING: CURLMsg *curlMessage is no longer valid after curl_multi_remove_handle()
+            finishTransfer(asyncTransfer, CURL_DONE, curlResult);
         }
         else
+            m_logger->error(fmt::format("failed to find matching AsyncTransfer object for handle {}", handle));
+    }
+
+    // the finished transfers freed their slots
+    if(!m_finishedHandles.empty())
+        admitPendingTransfers();
+}
+
+int CurlMultiAsync::staticOnSocketCallback([[maybe_unused]] CURL *handle, curl_socket_t socket, int what, void *token, [[maybe_unused]] void *socketToken)
+{
+    if(token != nullptr)
+        return static_cast<CurlMultiAsync*>(token)->onSocketCallback(socket, what);
+    else
+        return -1;
+}
+
+int CurlMultiAsync::onSocketCallback(curl_socket_t socket, int what)
+{
+    if(what == CURL_POLL_REMOVE)
+    {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socket, nullptr); // libcurl may have closed the socket already, so we ignore errors
+        return 0;
+    }
+
+    struct epoll_event event{};
+    event.data.fd = socket;
+    if((what == CURL_POLL_IN) || (what == CURL_POLL_INOUT))
+        event.events |= EPOLLIN;
+    if((what == CURL_POLL_OUT) || (what == CURL_POLL_INOUT))
+        event.events |= EPOLLOUT;
+
+    if(epoll_ctl(m_epollFd, EPOLL_CTL_MOD, socket, &event) == -1)
+    {
+        if((errno != ENOENT) || (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, socket, &event) == -1))
         {
-            // Until now, there are no other msg types defined in libcurl
-            m_logger->warning(fmt::format("got unknown message {} from handle {}", static_cast<int>(curlMessage->msg), curlMessage->easy_handle));
+            m_logger->error(fmt::format("epoll_ctl for socket {} failed: {}", socket, std::strerror(errno)));
+            return -1;
         }
     }
+
+    return 0;
+}
+
+int CurlMultiAsync::staticOnTimerCallback([[maybe_unused]] CURLM *multiHandle, long timeoutMs, void *token)
+{
+    if(token != nullptr)
+        return static_cast<CurlMultiAsync*>(token)->onTimerCallback(timeoutMs);
+    else
+        return -1;
+}
+
+int CurlMultiAsync::onTimerCallback(long timeoutMs)
+{
+    struct itimerspec timerValue{};
+
+    if(timeoutMs > 0)
+    {
+        timerValue.it_value.tv_sec  = timeoutMs / 1000;
+        timerValue.it_value.tv_nsec = (timeoutMs % 1000) * 1000000;
+    }
+    else if(timeoutMs == 0)
+    {
+        // We must not call curl_multi_socket_action() from within this callback, so we let the timer expire immediately.
+        timerValue.it_value.tv_nsec = 1;
+    }
+    // timeoutMs == -1 => the zeroed timerValue disarms the timer
+
+    if(timerfd_settime(m_timerFd, 0, &timerValue, nullptr) == -1)
+    {
+        m_logger->error(fmt::format("timerfd_settime failed: {}", std::strerror(errno)));
+        return -1;
+    }
+
+    return 0;
 }
 
 void CurlMultiAsync::restartMultiStack()
 {
     cancelAllTransfers();
 
+    // The producers call curl_multi_wakeup() with m_queueMutex held, so they never see a deleted handle
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+
     for(int i=0; i<3; i++)
     {
         curl_multi_cleanup(m_multiHandle);
-        m_multiHandle = curl_multi_init();
 
-        if(m_multiHandle != NULL)
+        if(initializeMultiStack())
             return;
 
         m_logger->error("curl_multi_init() failed !");
@@ -231,51 +1005,225 @@ void CurlMultiAsync::restartMultiStack()
     std::exit(-123);
 }
 
-std::shared_ptr<CurlAsyncTransfer> CurlMultiAsync::getNextIncomingTransfer()
+int CurlMultiAsync::eventLoopTimeoutMs()
 {
-    std::shared_ptr<CurlAsyncTransfer> transfer;
+    int timeoutMs = 1000;
 
-    const std::lock_guard<std::mutex> lock(m_queueMutex);
-    if(m_incomingTransfers.empty())
-        return transfer;
+    // Unpause the transfers with refilled buckets and wake up in time for the next one
+    if(m_bandwidthLimiter)
+    {
+        int resumeMs = m_bandwidthLimiter->_resumeTransfers();
+        if(resumeMs >= 0)
+            timeoutMs = std::min(timeoutMs, resumeMs);
+    }
 
-    transfer = m_incomingTransfers.front();
-    m_incomingTransfers.pop();
-    return transfer;
+    // Wake up for the next retry: its transfer is added to the multi stack by handleQueues()
+    if(!m_scheduledRetries.empty())
+    {
+        auto untilDue = std::chrono::ceil<std::chrono::milliseconds>(m_scheduledRetries.front().due - std::chrono::steady_clock::now());
+        timeoutMs = std::clamp(static_cast<int>(untilDue.count()), 0, timeoutMs);
+    }
+
+    if(!m_scheduledHedges.empty())
+    {
+        auto untilDue = std::chrono::ceil<std::chrono::milliseconds>(m_scheduledHedges.front().due - std::chrono::steady_clock::now());
+        timeoutMs = std::clamp(static_cast<int>(untilDue.count()), 0, timeoutMs);
+    }
+
+    return timeoutMs;
 }
 
-std::shared_ptr<CurlAsyncTransfer> CurlMultiAsync::getNextEleminatingTransfer()
+std::shared_ptr<CurlAsyncTransfer> CurlMultiAsync::removeTransferFromRunningTransfers(CURL *transferHandle)
 {
     std::shared_ptr<CurlAsyncTransfer> transfer;
 
-    const std::lock_guard<std::mutex> lock(m_queueMutex);
-    if(m_eleminatingTransfers.empty())
-        return transfer;
+    auto iter = m_runningTransfers.find(transferHandle);
+    if(iter != m_runningTransfers.end())
+    {
+        transfer = std::move(iter->second);
+        m_runningTransfers.erase(iter);
+        m_runningTransferCount = m_runningTransfers.size();
+
+        auto hostIterator = m_runningTransferHosts.find(transferHandle);
+        if(hostIterator != m_runningTransferHosts.end())
+        {
+            if(--m_hostTransferCounts[hostIterator->second] == 0)
+                m_hostTransferCounts.erase(hostIterator->second);
+
+            m_runningTransferHosts.erase(hostIterator);
+        }
+    }
 
-    transfer = m_eleminatingTransfers.front();
-    m_eleminatingTransfers.pop();
     return transfer;
 }
 
-std::shared_ptr<CurlAsyncTransfer> CurlMultiAsync::removeTransferFromRunningTransfers(CURL *transferHandle)
+void CurlMultiAsync::removeHandleFromMultiStack(CURL *handle)
 {
-    std::shared_ptr<CurlAsyncTransfer> transfer;
+    // Remove the handle before the transfer callback runs: the callback may hand the transfer to another CurlMultiAsync right away
+    curl_multi_remove_handle(m_multiHandle, handle);
+
+    // Don't leave the handle attached to the share: the transfer may outlive it and curl_share_cleanup() refuses to clean up shares in use
+    if(m_share)
+        curl_easy_setopt(handle, CURLOPT_SHARE, nullptr);
 
-    auto iter = std::find_if(m_runningTransfers.begin(), m_runningTransfers.end(), [&transferHandle](const std::shared_ptr<CurlAsyncTransfer> &entry)
+    if(m_bandwidthLimiter)
+        m_bandwidthLimiter->_removeTransfer(handle);
+}
+
+void CurlMultiAsync::finishTransfer(const std::shared_ptr<CurlAsyncTransfer> &transfer, AsyncResult asyncResult, CURLcode curlResult)
+{
+    // The copies of hedged transfers are never completed: only their original is
+    if(m_hedgingPolicy && resolveHedge(transfer, asyncResult, curlResult))
+        return;
+
+    if(m_completionMode == CompletionMode::QUEUED)
+    {
+        // The counter is decremented in drainCompletions()
+        try
         {
-            return entry->curl().handle == transferHandle;
+            transfer->_finishTransfer(asyncResult, curlResult);
+        }
+        catch(...)
+        {
+            queueCompletion(transfer);
+            throw;
         }
-    );
 
-    if(iter != m_runningTransfers.end())
+        if(!scheduleRetry(transfer))
+            queueCompletion(transfer);
+
+        return;
+    }
+
+    // Decrement after the callback, so that waitForCompletion() doesn't return before the callback has finished
+    try
     {
-        transfer = *iter;
-        m_runningTransfers.erase(iter);
+        transfer->_finishTransfer(asyncResult, curlResult);
+        if(scheduleRetry(transfer))
+            return; // still active
+
+        transfer->_completeTransfer();
+    }
+    catch(...)
+    {
+        transferCompleted();
+        throw;
     }
-    else
-        m_logger->error(fmt::format("failed to find matching AsyncTransfer object for handle {}", transferHandle));
 
-    return transfer;
+    transferCompleted();
+}
+
+void CurlMultiAsync::transferCompleted()
+{
+    m_completedTransferCount++;
+    m_activeTransferCount--;
+    notifyWaiters();
+}
+
+void CurlMultiAsync::notifyWaiters()
+{
+    // Taking the mutex orders this notification after the predicate check of a waiter, which is about to block
+    {
+        const std::lock_guard<std::mutex> lock(m_waitSignal->mutex);
+    }
+    m_waitSignal->condition.notify_all();
+}
+
+template<typename Predicate>
+bool CurlMultiAsync::waitUntil(Deadline deadline, Predicate predicate)
+{
+    std::unique_lock<std::mutex> lock(m_waitSignal->mutex);
+
+    if(deadline == Deadline::max())
+    {
+        m_waitSignal->condition.wait(lock, predicate);
+        return true;
+    }
+
+    return m_waitSignal->condition.wait_until(lock, deadline, predicate);
+}
+
+void CurlMultiAsync::queueCompletion(const std::shared_ptr<CurlAsyncTransfer> &transfer)
+{
+    const std::lock_guard<std::mutex> lock(m_completionMutex);
+    m_completions.push(transfer);
+
+    uint64_t value = 1;
+    [[maybe_unused]] auto written = write(m_completionFd, &value, sizeof(value));
+}
+
+void CurlMultiAsync::setMaxRunningTransfers(size_t newMaxRunningTransfers)
+{
+    m_maxRunningTransfers = newMaxRunningTransfers;
+
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    wakeupEventLoop(); // a higher limit may admit pending transfers
+}
+
+void CurlMultiAsync::setMaxTransfersPerHost(size_t newMaxTransfersPerHost)
+{
+    m_maxTransfersPerHost = newMaxTransfersPerHost;
+
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    wakeupEventLoop();
+}
+
+RetryStatistics CurlMultiAsync::retryStatistics() const
+{
+    RetryStatistics statistics;
+    statistics.attempts              = m_retryStatistics.attempts;
+    statistics.retries               = m_retryStatistics.retries;
+    statistics.recoveredTransfers    = m_retryStatistics.recoveredTransfers;
+    statistics.exhaustedTransfers    = m_retryStatistics.exhaustedTransfers;
+    statistics.nonIdempotentFailures = m_retryStatistics.nonIdempotentFailures;
+    statistics.scheduledRetries      = m_retryStatistics.scheduledRetries;
+    return statistics;
+}
+
+ConnectionPolicy CurlMultiAsync::connectionPolicy() const
+{
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_connectionPolicy;
+}
+
+void CurlMultiAsync::setConnectionPolicy(const ConnectionPolicy &newConnectionPolicy)
+{
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_connectionPolicy = newConnectionPolicy;
+    m_connectionPolicyChanged = true;
+
+    wakeupEventLoop();
+}
+
+std::shared_ptr<HedgingPolicy> CurlMultiAsync::hedgingPolicy() const
+{
+    return m_hedgingPolicy;
+}
+
+void CurlMultiAsync::setHedgingPolicy(std::shared_ptr<HedgingPolicy> newHedgingPolicy)
+{
+    m_hedgingPolicy = newHedgingPolicy;
+}
+
+HedgingStatistics CurlMultiAsync::hedgingStatistics() const
+{
+    HedgingStatistics statistics;
+    statistics.hedgedTransfers = m_hedgingStatistics.hedgedTransfers;
+    statistics.hedgeWins       = m_hedgingStatistics.hedgeWins;
+    statistics.skippedHedges   = m_hedgingStatistics.skippedHedges;
+    return statistics;
+}
+
+PriorityStatistics CurlMultiAsync::priorityStatistics(TransferPriority priority) const
+{
+    const auto &atomicStatistics = m_priorityStatistics.at(static_cast<size_t>(priority));
+
+    PriorityStatistics statistics;
+    statistics.queuedTransfers   = atomicStatistics.queuedTransfers;
+    statistics.admittedTransfers = atomicStatistics.admittedTransfers;
+    statistics.totalWait_us      = atomicStatistics.totalWait_us;
+    statistics.maxWait_us        = atomicStatistics.maxWait_us;
+    return statistics;
 }
 
 void CurlMultiAsync::setTraceConfiguration(std::shared_ptr<TraceConfigurationInterface> newTraceConfiguration)
@@ -283,4 +1231,29 @@ void CurlMultiAsync::setTraceConfiguration(std::shared_ptr<TraceConfigurationInt
     m_traceConfiguration = newTraceConfiguration;
 }
 
+std::shared_ptr<CurlShare> CurlMultiAsync::share() const
+{
+    return m_share;
+}
+
+void CurlMultiAsync::setShare(std::shared_ptr<CurlShare> newShare)
+{
+    m_share = newShare;
+}
+
+std::shared_ptr<BandwidthLimiter> CurlMultiAsync::bandwidthLimiter() const
+{
+    return m_bandwidthLimiter;
+}
+
+void CurlMultiAsync::setBandwidthLimiter(std::shared_ptr<BandwidthLimiter> newBandwidthLimiter)
+{
+    m_bandwidthLimiter = newBandwidthLimiter;
+}
+
+void CurlMultiAsync::_shareWaitSignal(std::shared_ptr<WaitSignal> waitSignal)
+{
+    m_waitSignal = std::move(waitSignal);
+}
+
 }
@@ -0,0 +1,266 @@
+#include "libcurl-wrapper/curlmultiasyncpool.hpp"
+#include "libcurl-wrapper/curlurl.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace curl
+{
+
+namespace
+{
+
+// The workers call configureTracing() from their own threads, but TraceConfiguration and friends are not thread safe
+class SynchronizedTraceConfiguration : public TraceConfigurationInterface
+{
+public:
+    explicit SynchronizedTraceConfiguration(std::shared_ptr<TraceConfigurationInterface> traceConfiguration)
+        : m_traceConfiguration(std::move(traceConfiguration))
+    {
+    }
+
+    virtual void configureTracing(std::shared_ptr<CurlAsyncTransfer> transfer) override
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_traceConfiguration->configureTracing(transfer);
+    }
+
+private:
+    std::mutex m_mutex;
+    std::shared_ptr<TraceConfigurationInterface> m_traceConfiguration;
+};
+
+}
+
+CurlMultiAsyncPool::CurlMultiAsyncPool(const cu::Logger &logger, size_t workerCount, ShardingStrategy shardingStrategy, EventLoop eventLoop)
+    : m_logger(logger),
+      m_shardingStrategy(shardingStrategy),
+      m_waitSignal(std::make_shared<WaitSignal>())
+{
+    workerCount = std::max<size_t>(workerCount, 1); // std::thread::hardware_concurrency() may return 0
+
+    m_workers.reserve(workerCount);
+    for(size_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(std::make_unique<CurlMultiAsync>(logger, eventLoop));
+        m_workers.back()->_shareWaitSignal(m_waitSignal);
+    }
+
+    m_logger->debug(fmt::format("started {} CurlMultiAsync workers", workerCount));
+}
+
+void CurlMultiAsyncPool::performTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    selectWorker(*transfer).performTransfer(transfer);
+}
+
+std::future<AsyncResult> CurlMultiAsyncPool::performTransferAsync(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    // The worker sets up the completion, so the pool can't drift apart from CurlMultiAsync
+    return selectWorker(*transfer).performTransferAsync(transfer);
+}
+
+void CurlMultiAsyncPool::cancelTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    // We don't keep track of the worker, which owns the transfer: workers ignore cancel requests for transfers they don't run
+    for(auto &worker : m_workers)
+        worker->cancelTransfer(transfer);
+}
+
+void CurlMultiAsyncPool::resumeTransfer(std::shared_ptr<CurlAsyncTransfer> transfer)
+{
+    // like cancel requests: the workers, which don't run the transfer, ignore it
+    for(auto &worker : m_workers)
+        worker->resumeTransfer(transfer);
+}
+
+void CurlMultiAsyncPool::performTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers)
+{
+    // Split the batch per worker first, so every worker is locked and woken up only once.
+    // For LEAST_LOADED we have to account for the transfers of this batch ourselves, because the workers haven't seen them yet.
+    std::vector<std::vector<std::shared_ptr<CurlAsyncTransfer>>> batches(m_workers.size());
+    std::vector<size_t> load(m_workers.size());
+    for(size_t i = 0; i < m_workers.size(); i++)
+        load[i] = m_workers[i]->activeTransfers();
+
+    for(const auto &transfer : transfers)
+    {
+        size_t worker = selectWorkerIndex(*transfer, load);
+        batches[worker].push_back(transfer);
+        load[worker]++;
+    }
+
+    for(size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i]->performTransfers(batches[i]);
+}
+
+void CurlMultiAsyncPool::cancelTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers)
+{
+    for(auto &worker : m_workers)
+        worker->cancelTransfers(transfers);
+}
+
+void CurlMultiAsyncPool::cancelAllTransfers()
+{
+    for(auto &worker : m_workers)
+        worker->cancelAllTransfers();
+}
+
+void CurlMultiAsyncPool::waitForCompletion()
+{
+    for(auto &worker : m_workers)
+        worker->waitForCompletion();
+}
+
+bool CurlMultiAsyncPool::waitForCompletion(CurlMultiAsync::Deadline deadline)
+{
+    for(auto &worker : m_workers)
+    {
+        if(!worker->waitForCompletion(deadline))
+            return false;
+    }
+
+    return true;
+}
+
+bool CurlMultiAsyncPool::waitForStarted(CurlMultiAsync::Deadline deadline)
+{
+    auto anyRunning = [this]()
+    {
+        return std::any_of(m_workers.begin(), m_workers.end(), [](const auto &worker) { return worker->runningTransfers() > 0; });
+    };
+
+    // The workers notify the shared signal, when they start transfers
+    std::unique_lock<std::mutex> lock(m_waitSignal->mutex);
+
+    if(deadline == CurlMultiAsync::Deadline::max())
+    {
+        m_waitSignal->condition.wait(lock, anyRunning);
+        return true;
+    }
+
+    return m_waitSignal->condition.wait_until(lock, deadline, anyRunning);
+}
+
+bool CurlMultiAsyncPool::waitForStarted(uint32_t timeoutMs)
+{
+    return waitForStarted(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+}
+
+void CurlMultiAsyncPool::setTraceConfiguration(std::shared_ptr<TraceConfigurationInterface> newTraceConfiguration)
+{
+    std::shared_ptr<TraceConfigurationInterface> traceConfiguration;
+    if(newTraceConfiguration)
+        traceConfiguration = std::make_shared<SynchronizedTraceConfiguration>(std::move(newTraceConfiguration));
+
+    for(auto &worker : m_workers)
+        worker->setTraceConfiguration(traceConfiguration);
+}
+
+void CurlMultiAsyncPool::setShare(std::shared_ptr<CurlShare> newShare)
+{
+    // The workers run concurrently: libcurl doesn't support a connection cache shared between them
+    if(newShare && newShare->sharesConnections())
+    {
+        std::string errMsg = "a CurlShare with shared connections can't be used by the threads of a CurlMultiAsyncPool";
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    for(auto &worker : m_workers)
+        worker->setShare(newShare);
+}
+
+void CurlMultiAsyncPool::setConnectionPolicy(const ConnectionPolicy &newConnectionPolicy)
+{
+    for(auto &worker : m_workers)
+        worker->setConnectionPolicy(newConnectionPolicy);
+}
+
+void CurlMultiAsyncPool::setMaxRunningTransfers(size_t newMaxRunningTransfers)
+{
+    for(auto &worker : m_workers)
+        worker->setMaxRunningTransfers(newMaxRunningTransfers);
+}
+
+void CurlMultiAsyncPool::setMaxTransfersPerHost(size_t newMaxTransfersPerHost)
+{
+    for(auto &worker : m_workers)
+        worker->setMaxTransfersPerHost(newMaxTransfersPerHost);
+}
+
+PriorityStatistics CurlMultiAsyncPool::priorityStatistics(TransferPriority priority) const
+{
+    PriorityStatistics statistics;
+    for(const auto &worker : m_workers)
+    {
+        PriorityStatistics workerStatistics = worker->priorityStatistics(priority);
+        statistics.queuedTransfers   += workerStatistics.queuedTransfers;
+        statistics.admittedTransfers += workerStatistics.admittedTransfers;
+        statistics.totalWait_us      += workerStatistics.totalWait_us;
+        statistics.maxWait_us         = std::max(statistics.maxWait_us, workerStatistics.maxWait_us);
+    }
+
+    return statistics;
+}
+
+RetryStatistics CurlMultiAsyncPool::retryStatistics() const
+{
+    RetryStatistics statistics;
+    for(const auto &worker : m_workers)
+    {
+        RetryStatistics workerStatistics = worker->retryStatistics();
+        statistics.attempts              += workerStatistics.attempts;
+        statistics.retries               += workerStatistics.retries;
+        statistics.recoveredTransfers    += workerStatistics.recoveredTransfers;
+        statistics.exhaustedTransfers    += workerStatistics.exhaustedTransfers;
+        statistics.nonIdempotentFailures += workerStatistics.nonIdempotentFailures;
+        statistics.scheduledRetries      += workerStatistics.scheduledRetries;
+    }
+
+    return statistics;
+}
+
+size_t CurlMultiAsyncPool::workerCount() const
+{
+    return m_workers.size();
+}
+
+size_t CurlMultiAsyncPool::activeTransfers() const
+{
+    size_t transfers = 0;
+    for(const auto &worker : m_workers)
+        transfers += worker->activeTransfers();
+
+    return transfers;
+}
+
+CurlMultiAsync &CurlMultiAsyncPool::selectWorker(const CurlAsyncTransfer &transfer) const
+{
+    std::vector<size_t> load(m_workers.size());
+    for(size_t i = 0; i < m_workers.size(); i++)
+        load[i] = m_workers[i]->activeTransfers();
+
+    return *m_workers.at(selectWorkerIndex(transfer, load));
+}
+
+size_t CurlMultiAsyncPool::selectWorkerIndex(const CurlAsyncTransfer &transfer, const std::vector<size_t> &load) const
+{
+    if(m_shardingStrategy == ShardingStrategy::HOST_AFFINITY)
+    {
+        Url url(transfer.url());
+        std::string host = url.host();
+
+        if(!host.empty())
+            return std::hash<std::string>{}(host) % m_workers.size();
+
+        // without a host, we fall back to the least loaded worker
+    }
+
+    return std::distance(load.begin(), std::min_element(load.begin(), load.end()));
+}
+
+}
@@ -0,0 +1,121 @@
+#include "libcurl-wrapper/curlshare.hpp"
+
+#include <fmt/core.h>
+
+namespace curl
+{
+
+CurlShare::CurlShare(const cu::Logger &logger, bool shareDns, bool shareSslSessions, bool shareConnections, bool sharePsl)
+    : m_logger(logger)
+{
+    m_handle = curl_share_init();
+
+    if(m_handle == NULL)
+    {
+        std::string errMsg = "curl_share_init() failed !!!";
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    curl_share_setopt(m_handle, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(m_handle, CURLSHOPT_LOCKFUNC, &staticOnLockCallback);
+    curl_share_setopt(m_handle, CURLSHOPT_UNLOCKFUNC, &staticOnUnlockCallback);
+
+    if(shareDns)
+        share(CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    if(shareSslSessions)
+        share(CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    if(shareConnections)
+    {
+        share(CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        m_sharesConnections = true;
+    }
+    if(sharePsl)
+        share(CURLSHOPT_SHARE, CURL_LOCK_DATA_PSL);
+}
+
+CurlShare::~CurlShare()
+{
+    // fails with CURLSHE_IN_USE, if there are still easy handles using this share: CurlMultiAsync detaches them after each transfer
+    CURLSHcode sc = curl_share_cleanup(m_handle);
+    if(sc != CURLSHE_OK)
+        m_logger->error(fmt::format("curl_share_cleanup() failed: {}", curl_share_strerror(sc)));
+}
+
+CURLSH *CurlShare::handle() const
+{
+    return m_handle;
+}
+
+bool CurlShare::sharesConnections() const
+{
+    return m_sharesConnections;
+}
+
+void CurlShare::recordTransfer(CURL *handle)
+{
+    long newConnections = 0;
+    if(curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &newConnections) != CURLE_OK)
+        return;
+
+    if(newConnections == 0)
+    {
+        m_reusedConnections++;
+        return;
+    }
+
+    m_newConnections += newConnections;
+
+    curl_off_t appConnectTime_us = 0;
+    if((curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnectTime_us) == CURLE_OK) && (appConnectTime_us > 0))
+        m_tlsHandshakes++;
+}
+
+CurlShareStatistics CurlShare::statistics() const
+{
+    CurlShareStatistics statistics;
+    statistics.reusedConnections = m_reusedConnections;
+    statistics.newConnections    = m_newConnections;
+    statistics.tlsHandshakes     = m_tlsHandshakes;
+    statistics.lockAcquisitions  = m_lockAcquisitions;
+    statistics.lockContentions   = m_lockContentions;
+    return statistics;
+}
+
+void CurlShare::share(CURLSHoption option, curl_lock_data data)
+{
+    CURLSHcode sc = curl_share_setopt(m_handle, option, data);
+    if(sc != CURLSHE_OK)
+        m_logger->warning(fmt::format("failed to share data {}: {}", static_cast<int>(data), curl_share_strerror(sc)));
+}
+
+void CurlShare::staticOnLockCallback([[maybe_unused]] CURL *handle, curl_lock_data data, [[maybe_unused]] curl_lock_access access, void *token)
+{
+    if(token != nullptr)
+        static_cast<CurlShare*>(token)->onLockCallback(data);
+}
+
+void CurlShare::onLockCallback(curl_lock_data data)
+{
+    std::mutex &mutex = m_mutexes.at(data);
+
+    m_lockAcquisitions++;
+    if(!mutex.try_lock())
+    {
+        m_lockContentions++;
+        mutex.lock();
+    }
+}
+
+void CurlShare::staticOnUnlockCallback([[maybe_unused]] CURL *handle, curl_lock_data data, void *token)
+{
+    if(token != nullptr)
+        static_cast<CurlShare*>(token)->onUnlockCallback(data);
+}
+
+void CurlShare::onUnlockCallback(curl_lock_data data)
+{
+    m_mutexes.at(data).unlock();
+}
+
+}
@@ -68,6 +68,24 @@ std::string Url::toString()
     return url;
 }
 
+std::string Url::host()
+{
+    if(!m_isValid)
+        return "";
+
+    char *hostFromCurl;
+    if(curl_url_get(m_handle, CURLUPART_HOST, &hostFromCurl, 0) != CURLUE_OK)
+    {
+        curl_free(hostFromCurl);
+        return std::string(); // e.g. file:// URLs don't have a host, but are still valid
+    }
+
+    std::string host = std::string(hostFromCurl);
+    curl_free(hostFromCurl);
+
+    return host;
+}
+
 bool Url::setPath(const std::string &path, bool overwriteExisting)
 {
     if(!m_isValid)
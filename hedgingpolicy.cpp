@@ -0,0 +1,33 @@
+#include "libcurl-wrapper/hedgingpolicy.hpp"
+
+#include <algorithm>
+
+namespace curl
+{
+
+void HedgingPolicy::setPercentile(double newPercentile)
+{
+    m_percentile = std::clamp(newPercentile, 0.0, 1.0);
+}
+
+void HedgingPolicy::setMinSamples(uint64_t newMinSamples)
+{
+    m_minSamples = newMinSamples;
+}
+
+void HedgingPolicy::setMinDelay(std::chrono::milliseconds newMinDelay)
+{
+    m_minDelay = newMinDelay;
+}
+
+bool HedgingPolicy::hedgeDelay(const LatencyHistogram &hostLatencies, std::chrono::microseconds &delay) const
+{
+    // Without enough history every request would look slow
+    if((hostLatencies.count() == 0) || (hostLatencies.count() < m_minSamples))
+        return false;
+
+    delay = std::max<std::chrono::microseconds>(hostLatencies.percentile(m_percentile), m_minDelay);
+    return true;
+}
+
+}
@@ -0,0 +1,176 @@
+#include "libcurl-wrapper/httpheaders.hpp"
+
+#include <algorithm>
+
+namespace curl
+{
+
+namespace
+{
+
+constexpr std::string_view whitespace = " \t\r\n";
+
+std::string_view trimmed(std::string_view text)
+{
+    size_t first = text.find_first_not_of(whitespace);
+    if(first == std::string_view::npos)
+        return std::string_view();
+
+    size_t last = text.find_last_not_of(whitespace);
+    return text.substr(first, last - first + 1);
+}
+
+char toLower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+bool lessIgnoreCase(std::string_view a, std::string_view b)
+{
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) { return toLower(x) < toLower(y); });
+}
+
+}
+
+bool parseHeaderLine(std::string_view line, std::string_view &name, std::string_view &value)
+{
+    size_t colon = line.find(':');
+    if((colon == 0) || (colon == std::string_view::npos))
+        return false;
+
+    name = line.substr(0, colon);
+    if(name.find_first_of(whitespace) != std::string_view::npos) // also rejects folded continuation lines
+        return false;
+
+    value = trimmed(line.substr(colon + 1));
+    return true;
+}
+
+bool parseStatusLine(std::string_view line, std::string_view &httpVersion)
+{
+    if(line.compare(0, 5, "HTTP/") != 0)
+        return false;
+
+    httpVersion = line.substr(0, line.find_first_of(whitespace));
+    return true;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if(a.size() != b.size())
+        return false;
+
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        if(toLower(a[i]) != toLower(b[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value)
+{
+    if(m_arena.capacity() == 0)
+        m_arena.reserve(1024); // enough for the headers of most responses
+
+    Entry entry;
+    entry.nameOffset = static_cast<uint32_t>(m_arena.size());
+    entry.nameSize = static_cast<uint32_t>(name.size());
+    m_arena.append(name);
+
+    entry.valueOffset = static_cast<uint32_t>(m_arena.size());
+    entry.valueSize = static_cast<uint32_t>(value.size());
+    m_arena.append(value);
+
+    m_entries.push_back(entry);
+    m_indexValid = false;
+}
+
+void HttpHeaders::clear()
+{
+    m_arena.clear();
+    m_entries.clear();
+    m_index.clear();
+    m_indexValid = false;
+}
+
+bool HttpHeaders::contains(std::string_view name) const
+{
+    return !values(name).empty();
+}
+
+std::string_view HttpHeaders::value(std::string_view name) const
+{
+    Values headerValues = values(name);
+
+    std::string_view lastValue;
+    for(std::string_view headerValue : headerValues)
+        lastValue = headerValue;
+
+    return lastValue;
+}
+
+HttpHeaders::Values HttpHeaders::values(std::string_view name) const
+{
+    if(!m_indexValid)
+        updateIndex();
+
+    auto lessThan = [this](uint32_t entryIndex, std::string_view key) { return lessIgnoreCase(this->name(entryIndex), key); };
+    auto greaterThan = [this](std::string_view key, uint32_t entryIndex) { return lessIgnoreCase(key, this->name(entryIndex)); };
+
+    auto first = std::lower_bound(m_index.begin(), m_index.end(), name, lessThan);
+    auto last = std::upper_bound(first, m_index.end(), name, greaterThan);
+
+    return Values(this, m_index.data() + (first - m_index.begin()), m_index.data() + (last - m_index.begin()));
+}
+
+size_t HttpHeaders::size() const
+{
+    return m_entries.size();
+}
+
+bool HttpHeaders::empty() const
+{
+    return m_entries.empty();
+}
+
+HttpHeaders::Iterator HttpHeaders::begin() const
+{
+    return Iterator(this, 0);
+}
+
+HttpHeaders::Iterator HttpHeaders::end() const
+{
+    return Iterator(this, m_entries.size());
+}
+
+HttpHeader HttpHeaders::header(const Entry &entry) const
+{
+    return HttpHeader{std::string_view(m_arena.data() + entry.nameOffset, entry.nameSize),
+                      std::string_view(m_arena.data() + entry.valueOffset, entry.valueSize)};
+}
+
+std::string_view HttpHeaders::name(uint32_t entryIndex) const
+{
+    const Entry &entry = m_entries[entryIndex];
+    return std::string_view(m_arena.data() + entry.nameOffset, entry.nameSize);
+}
+
+void HttpHeaders::buildIndex()
+{
+    if(!m_indexValid)
+        updateIndex();
+}
+
+void HttpHeaders::updateIndex() const
+{
+    m_index.resize(m_entries.size());
+    for(uint32_t i = 0; i < m_index.size(); i++)
+        m_index[i] = i;
+
+    std::stable_sort(m_index.begin(), m_index.end(), [this](uint32_t a, uint32_t b) { return lessIgnoreCase(name(a), name(b)); });
+    m_indexValid = true;
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "cpp-utils/logging.hpp"
+#include "libcurl-wrapper/tracefile.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace curl
+{
+
+// Writes the trace files of many transfers on one background thread. The transfers only copy their entries into a
+// bounded lock-free ring (the MPMC queue of D. Vyukov), which never blocks them: if it is full, the entry is dropped and counted.
+// The files are written with large buffered writes and flushed, whenever the ring runs empty.
+class AsyncTraceWriter
+{
+public:
+    explicit AsyncTraceWriter(const cu::Logger& logger, size_t capacity = 4096); // capacity in entries, rounded up to a power of two
+    ~AsyncTraceWriter();                                                       // writes all queued entries
+
+    AsyncTraceWriter(const AsyncTraceWriter&) = delete;
+    AsyncTraceWriter &operator=(const AsyncTraceWriter&) = delete;
+
+    void flush(); // blocks until everything queued before has been written to the files
+
+    uint64_t writtenEntries() const;
+    uint64_t droppedEntries() const;
+
+    // Used by AsyncTraceFile
+    struct Output
+    {
+        std::string filename;
+        std::ofstream file;
+        std::unique_ptr<char[]> buffer;
+    };
+
+    enum class EntryKind
+    {
+        CURL_DEBUG_INFO,
+        MESSAGE,
+        CLOSE // deletes the output; never dropped
+    };
+
+    struct Entry
+    {
+        Output *output{nullptr};
+        EntryKind kind{EntryKind::MESSAGE};
+        curl_infotype type{CURLINFO_TEXT};
+        size_t size{0};
+        std::chrono::milliseconds time{0};
+        TracePayload payload{TracePayload::DATA};
+        uint32_t maxDataSize{0};
+        uint64_t droppedBefore{0}; // entries of this output, which were dropped since the last one
+    };
+
+    Output *_openOutput(const std::string &filename); // on the calling thread, so that errors are reported to it
+    bool _tryPush(const Entry &entry, std::string_view data);
+    void _push(const Entry &entry);                   // spins while the ring is full
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence{0};
+        Entry entry;
+        std::string data; // keeps its capacity: after warming up, copying an entry doesn't allocate
+    };
+
+    bool enqueue(const Entry &entry, std::string_view data);
+    void threadedFunction();
+    bool writeNextEntry();
+    void writeEntry(const Entry &entry, std::string &data);
+    void flushOutputs();
+
+    cu::Logger m_logger;
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePosition{0};
+    alignas(64) std::atomic<size_t> m_dequeuePosition{0}; // only advanced by the thread
+    std::atomic<uint64_t> m_writtenEntries{0};
+    std::atomic<uint64_t> m_droppedEntries{0};
+    std::atomic<bool> m_sleeping{false};
+
+    std::unordered_set<Output*> m_outputs; // only used by the thread: flushed while the ring is empty
+    std::atomic<bool> m_threadKeepRunning{true};
+    std::mutex m_waitMutex; // only for the sleeps of the thread and flush(), never taken by a producer on the fast path
+    std::condition_variable m_wakeupCondition;
+    std::condition_variable m_flushedCondition;
+    size_t m_flushRequests{0};
+    size_t m_flushedPosition{0};
+    std::unique_ptr<std::thread> m_thread;
+};
+
+// Trace file of one transfer, written by an AsyncTraceWriter: same format as TraceFile
+class AsyncTraceFile : public TracingInterface
+{
+public:
+    AsyncTraceFile(const cu::Logger& logger, std::shared_ptr<AsyncTraceWriter> writer);
+    virtual ~AsyncTraceFile() override;
+
+    virtual void traceCurlDebugInfo(CURL *handle, curl_infotype type, char *data, size_t size) override;
+    virtual void traceMessage(std::string_view entry) override;
+
+    virtual void initialize() override;
+    virtual void finalize() override;
+
+    const std::string &filename() const;
+    void setFilename(const std::string &newFilename);
+
+    uint32_t maxDataSize() const;
+    void setMaxDataSize(uint32_t newMaxDataSize);
+
+    void enableSslData(bool newEnableSslData);
+
+    uint64_t droppedEntries() const;
+
+private:
+    void push(AsyncTraceWriter::Entry &entry, std::string_view data);
+
+    cu::Logger m_logger;
+    std::shared_ptr<AsyncTraceWriter> m_writer;
+    AsyncTraceWriter::Output *m_output{nullptr}; // owned by the writer after the CLOSE entry
+    std::string m_filename;
+    uint32_t m_maxDataSize{0};
+    uint32_t m_dataSize{0};
+    bool m_enableSslData{false};
+    uint64_t m_droppedSinceLastEntry{0};
+    uint64_t m_droppedEntries{0};
+    std::chrono::steady_clock::time_point m_timepointTransferBegin;
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "curlasynctransfer.hpp"
+
+#include <curl/curl.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+namespace curl
+{
+
+// Token buckets for the aggregate upload and download rate of the transfers of one CurlMultiAsync.
+// The rate is split between the priorities with running transfers according to their weights.
+// A transfer, which overdraws the bucket of its priority, is paused with curl_easy_pause() until the bucket is refilled;
+// a transfer, which its UploadSource paused as well, only continues the download then.
+// The setters may be called from any thread, everything else is only used by the thread of the CurlMultiAsync.
+class BandwidthLimiter
+{
+public:
+    BandwidthLimiter(uint64_t maxUploadBytesPerSecond, uint64_t maxDownloadBytesPerSecond); // 0 means unlimited
+    BandwidthLimiter(const BandwidthLimiter &other) = delete;
+
+    BandwidthLimiter& operator=(const BandwidthLimiter &other) = delete;
+
+    void setMaxUploadBytesPerSecond(uint64_t newMaxUploadBytesPerSecond);
+    void setMaxDownloadBytesPerSecond(uint64_t newMaxDownloadBytesPerSecond);
+    void setWeight(TransferPriority priority, unsigned int weight); // defaults: HIGH 4, NORMAL 2, BULK 1
+
+    // These functions are called from CurlMultiAsync and CurlAsyncTransfer
+    void _addTransfer(CurlAsyncTransfer *transfer);
+    void _removeTransfer(CURL *handle);
+    void _consume(CURL *handle, uint64_t uploadedBytes, uint64_t downloadedBytes);
+    int _resumeTransfers(); // returns the milliseconds until the next paused transfer may continue, -1 if none is paused
+
+private:
+    enum Direction
+    {
+        UPLOAD,
+        DOWNLOAD
+    };
+
+    struct TransferState
+    {
+        CurlAsyncTransfer *transfer; // keeps the pause reasons; removed before the transfer is finished
+        TransferPriority priority;
+    };
+
+    void refill(std::chrono::steady_clock::time_point now);
+    double ratePerPriority(Direction direction, size_t priority) const; // bytes per second, 0 means unlimited
+    bool overdrawn(size_t priority) const;
+
+    std::array<std::atomic<uint64_t>, 2> m_maxBytesPerSecond;
+    std::array<std::atomic<unsigned int>, transferPriorityCount> m_weights;
+
+    std::unordered_map<CURL*, TransferState> m_transfers;
+    std::array<size_t, transferPriorityCount> m_runningTransfers{};
+    std::array<std::array<double, 2>, transferPriorityCount> m_tokens{}; // may become negative: the debt is paid before the transfers continue
+    size_t m_pausedTransfers{0};
+    std::chrono::steady_clock::time_point m_lastRefill;
+};
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "cpp-utils/logging.hpp"
+#include "libcurl-wrapper/tracefile.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace curl
+{
+
+// Layout of a binary trace file (.ctb), all numbers little endian:
+//   file header: "CTB1", uint32 flags (bit 0: zstd compressed blocks), uint32 max data size
+//   blocks:      uint32 raw size, uint32 stored size, stored bytes (a zstd frame, if compressed)
+//   records:     uint32 length of the rest of the record, uint8 kind, uint8 curl_infotype, uint8 TracePayload, uint8 reserved,
+//                uint32 size, uint64 time in us since the transfer began, uint64 transfer id, raw data (only for TracePayload::DATA)
+// The records are collected in blocks of 64 KiB, which are compressed as a whole.
+enum class BinaryTraceRecordKind : uint8_t
+{
+    CURL_DEBUG_INFO = 0,
+    MESSAGE = 1
+};
+
+struct BinaryTraceRecord
+{
+    BinaryTraceRecordKind kind{BinaryTraceRecordKind::MESSAGE};
+    curl_infotype type{CURLINFO_TEXT};
+    TracePayload payload{TracePayload::DATA};
+    uint32_t size{0};                 // of the traced data, also if it isn't stored
+    std::chrono::microseconds time{0};
+    uint64_t transferId{0};
+    std::vector<char> data;
+};
+
+// Writes the libcurl debug events of a transfer as raw bytes: no hexdump, no flush per event.
+// BinaryTraceReader renders the same text as TraceFile on demand.
+class BinaryTraceFile : public TracingInterface
+{
+public:
+    explicit BinaryTraceFile(const cu::Logger& logger);
+    virtual ~BinaryTraceFile() override;
+
+    static bool compressionSupported(); // false, if libcurl-wrapper was built without zstd
+
+    // The record layout, shared with MappedTracePool
+    static constexpr size_t recordHeaderSize = 28; // including the length field
+    static void encodeRecordHeader(char *header, BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size,
+                                   std::chrono::microseconds time, uint64_t transferId, size_t dataSize);
+
+    virtual void traceCurlDebugInfo(CURL *handle, curl_infotype type, char *data, size_t size) override;
+    virtual void traceMessage(std::string_view entry) override;
+
+    virtual void initialize() override;
+    virtual void finalize() override;
+
+    // Records, which were encoded with encodeRecordHeader before, e.g. by ConditionalTraceCapture; their times are kept
+    void appendEncodedRecords(const char *records, size_t size);
+
+    const std::string &filename() const;
+    void setFilename(const std::string &newFilename);
+
+    uint32_t maxDataSize() const;
+    void setMaxDataSize(uint32_t newMaxDataSize);
+
+    void enableSslData(bool newEnableSslData);
+    void enableCompression(bool newEnableCompression); // ignored without zstd support
+    void setTransferId(uint64_t newTransferId);
+
+private:
+    void appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize);
+    void writeBlock();
+
+    cu::Logger m_logger;
+    std::string m_filename;
+    uint32_t m_maxDataSize{0};
+    uint32_t m_dataSize{0};
+    bool m_enableSslData{false};
+    bool m_enableCompression{false};
+    uint64_t m_transferId{0};
+    std::ofstream m_file;
+    std::vector<char> m_block;
+    std::vector<char> m_compressedBlock;
+    std::chrono::steady_clock::time_point m_timepointTransferBegin;
+};
+
+class BinaryTraceReader
+{
+public:
+    explicit BinaryTraceReader(const cu::Logger& logger);
+
+    void open(const std::string &filename); // throws, if the file can't be opened or isn't a binary trace file
+    bool next(BinaryTraceRecord &record);   // false at the end; throws, if the file is corrupt
+
+    uint32_t maxDataSize() const;
+
+    // The text layout of TraceFile
+    void writeText(std::ostream &stream, BinaryTraceRecord &record) const;
+    static void writeText(std::ostream &stream, BinaryTraceRecord &record, uint32_t maxDataSize);
+
+    // Decodes the record at the offset and advances it; false, if there is no valid record
+    static bool decodeRecord(const char *data, size_t size, size_t &offset, BinaryTraceRecord &record);
+
+private:
+    bool readBlock();
+    [[noreturn]] void fail(const std::string &message) const;
+
+    cu::Logger m_logger;
+    std::string m_filename;
+    std::ifstream m_file;
+    uint32_t m_flags{0};
+    uint32_t m_maxDataSize{0};
+    std::vector<char> m_block;
+    std::vector<char> m_storedBlock;
+    size_t m_blockOffset{0};
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cpp-utils/logging.hpp"
+#include "libcurl-wrapper/binarytracefile.hpp"
+#include "libcurl-wrapper/curlasynctransfer.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace curl
+{
+
+// Which transfers ConditionalTraceCapture writes out
+struct TraceCapturePolicy
+{
+    bool captureTimeouts{true};
+    bool captureCanceled{true};
+    bool captureCurlErrors{true};           // any CURLcode but CURLE_OK
+    bool captureServerErrors{false};        // HTTP status 5xx
+    std::vector<long> responseCodes;        // further HTTP status codes, e.g. 404 or 429
+    double sampleRate{0.0};                 // probability for writing out any other transfer
+    size_t maxBufferSize{16 * 1024 * 1024}; // per transfer: later records are dropped
+
+    bool shouldCapture(AsyncResult asyncResult, CURLcode curlResult, long responseCode) const;
+};
+
+// Gets the records in the layout of BinaryTraceFile
+using TraceCaptureWriter = std::function<void (uint64_t transferId, uint32_t maxDataSize, const std::vector<char> &records)>;
+
+// Traces a transfer into memory and hands the records to the writer only if the policy selects the transfer, when it is finished.
+// Transfers, which are not selected, cost a memcpy per libcurl debug event, but no formatting and no syscall.
+class ConditionalTraceCapture : public TracingInterface
+{
+public:
+    ConditionalTraceCapture(const cu::Logger& logger, const TraceCapturePolicy &policy, TraceCaptureWriter writer);
+    virtual ~ConditionalTraceCapture() override;
+
+    virtual void traceCurlDebugInfo(CURL *handle, curl_infotype type, char *data, size_t size) override;
+    virtual void traceMessage(std::string_view entry) override;
+
+    virtual void initialize() override;
+    virtual void finalize() override;
+    virtual void transferFinished(CurlAsyncTransfer *transfer) override;
+
+    uint32_t maxDataSize() const;
+    void setMaxDataSize(uint32_t newMaxDataSize);
+
+    void enableSslData(bool newEnableSslData);
+    void setTransferId(uint64_t newTransferId);
+
+private:
+    void appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize);
+    void encodeRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize);
+
+    cu::Logger m_logger;
+    TraceCapturePolicy m_policy;
+    TraceCaptureWriter m_writer;
+    std::vector<char> m_records;
+    uint64_t m_droppedRecords{0};
+    bool m_captured{false};
+    uint32_t m_maxDataSize{0};
+    uint32_t m_dataSize{0};
+    bool m_enableSslData{false};
+    uint64_t m_transferId{0};
+    std::chrono::steady_clock::time_point m_timepointTransferBegin;
+};
+
+}
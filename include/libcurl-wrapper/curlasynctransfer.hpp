@@ -21,8 +21,40 @@ enum AsyncResult
     TIMEOUT
 };
 
+enum class TransferPriority
+{
+    HIGH,   // latency critical control requests: admitted to the multi stack first
+    NORMAL,
+    BULK    // large uploads and downloads: deferred while the limits of the CurlMultiAsync are reached
+};
+
+constexpr size_t transferPriorityCount = 3;
+
+enum class PauseReason
+{
+    BANDWIDTH_LIMIT, // the BandwidthLimiter paused it with curl_easy_pause()
+    UPLOAD_SOURCE    // the UploadSource had no data and returned CURL_READFUNC_PAUSE
+};
+
+// Phases of the last attempt: libcurl measures each of them from the start of the attempt, so the non-zero values of
+// nameLookup, connect, appConnect, preTransfer, startTransfer and total are ascending; a skipped phase is 0 (see the fields)
+struct TransferTimings
+{
+    std::chrono::microseconds queueWait{0};     // from the submission to CurlMultiAsync until the attempt started
+    std::chrono::microseconds nameLookup{0};    // DNS resolved
+    std::chrono::microseconds connect{0};       // TCP connected; 0 on a reused connection
+    std::chrono::microseconds appConnect{0};    // TLS handshake done; 0 without TLS and on a reused connection
+    std::chrono::microseconds preTransfer{0};   // about to send the request
+    std::chrono::microseconds startTransfer{0}; // first byte of the response received
+    std::chrono::microseconds total{0};
+    std::chrono::microseconds redirect{0};      // all redirects before the final request; 0 without redirects
+};
+
+class BandwidthLimiter;
+class RetryPolicy;
 class CurlAsyncTransfer;
 using TransferCallback = std::function<void (CurlAsyncTransfer *transfer)>;
+using CompletionHandler = std::function<void (AsyncResult asyncResult)>;
 
 class CurlAsyncTransfer
 {
@@ -31,11 +63,16 @@ public:
     virtual ~CurlAsyncTransfer() = default; // Prevent undefined behavior when used as base class and delete per base class pointer
 
     const CurlHolder &curl() const;
+    uint64_t transferId() const; // unique in the process, e.g. to tell transfers apart in a shared trace
 
     void setUrl(const std::string &url);
+    const std::string &url() const;
     void setVerifySslCertificates(bool doVerifySslCertificates = true);
     void setReuseExistingConnection(bool doReuseExistingConnection = true);
 
+    TransferPriority priority() const;
+    void setPriority(TransferPriority newPriority);
+
     void setTransferCallback(const TransferCallback &newTransferCallback);
     CURLcode curlResult() const;
     AsyncResult asyncResult() const;
@@ -48,16 +85,54 @@ public:
 
     long responseCode() const;
 
+    // Caps for this transfer alone, enforced by libcurl; 0 means unlimited. The BandwidthLimiter of the CurlMultiAsync applies on top.
+    void setMaxUploadSpeed_BytesPerSecond(uint64_t maxUploadSpeed);
+    void setMaxDownloadSpeed_BytesPerSecond(uint64_t maxDownloadSpeed);
+
+    // With a RetryPolicy, CurlMultiAsync submits the transfer again after a retryable failure: prepareTransfer() runs for
+    // every attempt, processResponse() and the TransferCallback only for the last one
+    std::shared_ptr<RetryPolicy> retryPolicy() const;
+    void setRetryPolicy(std::shared_ptr<RetryPolicy> newRetryPolicy);
+    unsigned int attempts() const; // of the current or last submission
+
+    virtual bool isIdempotent() const { return true; }                                   // may the request be sent twice?
+    virtual std::chrono::milliseconds retryAfter() const { return std::chrono::milliseconds(0); } // minimum delay requested by the server
+
     virtual void prepareTransfer() { }
+    virtual void finishTransfer() { } // on the thread of the CurlMultiAsync, when the results are known; before a retry or processResponse()
     virtual void processResponse() { }
 
-    // These two functions are called from CurlMultiAsync
+    // These functions are called from CurlMultiAsync
     void _prepareTransfer();
-    void _processResponse(AsyncResult asyncResult, CURLcode curlResult);
+    void _processResponse(AsyncResult asyncResult, CURLcode curlResult); // _finishTransfer() + _completeTransfer()
+    void _finishTransfer(AsyncResult asyncResult, CURLcode curlResult);  // collects the results; always on the thread of the CurlMultiAsync
+    void _completeTransfer();                                            // processResponse() and the callbacks; may run on another thread
+
+    // Set by CurlMultiAsync on submission: the time until _prepareTransfer() is the queue wait
+    void _setTimepointQueued(std::chrono::steady_clock::time_point timepointQueued);
+    void _resetAttempts(); // on submission: retries are counted from here
+    std::chrono::steady_clock::time_point timepointQueued() const;
+
+    // One-shot handler for the next completion, called after the TransferCallback; used by the future and coroutine API
+    void _setCompletionHandler(const CompletionHandler &completionHandler);
+
+    // Request hedging in CurlMultiAsync: the clone sends the same request, but writes into its own buffers.
+    // nullptr means the transfer can't be hedged; the base class writes to stdout by default, so it never can.
+    virtual std::shared_ptr<CurlAsyncTransfer> _cloneForHedging() const { return nullptr; }
+    virtual void _adoptHedge(CurlAsyncTransfer &hedge); // takes over the handle and the results of the finished clone
+
+    // Set by CurlMultiAsync before the transfer starts: the progress callback reports the transferred bytes to it
+    void _setBandwidthLimiter(BandwidthLimiter *bandwidthLimiter);
+
+    // Each reason is tracked on its own, so libcurl only continues the transfer, when no reason is left; on the thread of the CurlMultiAsync
+    bool _pause(PauseReason reason); // false if curl_easy_pause() failed
+    void _resume(PauseReason reason);
+    bool _isPaused(PauseReason reason) const;
 
     void setTracing(std::unique_ptr<TracingInterface> newTracing);
 
     float transferDuration_s() const;
+    const TransferTimings &transferTimings() const; // collected for every transfer, no tracing needed
     uint64_t transferSpeed_BytesPerSecond() const;
     uint64_t transferredBytes() const;
 
@@ -70,11 +145,22 @@ protected:
     static int staticOnDebugCallback(CURL *handle, curl_infotype type, char *data, size_t size, void *token);
     int onDebugCallback(CURL *handle, curl_infotype type, char *data, size_t size);
 
+    // Reports transferred bytes to the BandwidthLimiter and may pause the transfer. The progress callback reports everything,
+    // which wasn't reported yet, but libcurl may receive megabytes in between: subclasses call it from their data callbacks.
+    void consumeBandwidth(uint64_t uploadedBytes, uint64_t downloadedBytes);
+
+    bool copyForHedging(CurlAsyncTransfer &hedge) const; // for _cloneForHedging(): duplicates the handle and the settings of this class
+
     cu::Logger m_logger;
+    uint64_t m_transferId;
     CurlHolder m_curl;
+    std::string m_url;
     CURLcode   m_curlResult{CURL_LAST}; // result from the curl transfer; only valid if AsyncResult == CURL_DONE
     AsyncResult m_asyncResult{NONE};    // state of the async operation
     TransferCallback m_transferCallback;
+    CompletionHandler m_completionHandler;
+    TransferPriority m_priority{TransferPriority::NORMAL};
+    std::chrono::steady_clock::time_point m_timepointQueued;
     std::chrono::steady_clock::time_point m_timepointTransferBegin;
     std::chrono::steady_clock::time_point m_timepointLastProgress;
     std::chrono::steady_clock::time_point m_timepointLastProgressLogEntry;
@@ -83,7 +169,15 @@ protected:
     unsigned int m_maxTransferDuration_s{0};
     long m_responseCode{-1};
     std::unique_ptr<TracingInterface> m_tracing;
+    BandwidthLimiter *m_bandwidthLimiter{nullptr};
+    bool m_pausedByLimiter{false};
+    bool m_pausedBySource{false};
+    std::shared_ptr<RetryPolicy> m_retryPolicy;
+    unsigned int m_attempts{0};
+    uint64_t m_consumedUploadBytes{0};
+    uint64_t m_consumedDownloadBytes{0};
     float m_transferDuration_s{0.0};
+    TransferTimings m_transferTimings;
     uint64_t m_transferSpeed_BytesPerSecond{0};
     curl_off_t m_downloadedBytes{0};
     curl_off_t m_uploadededBytes{0};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace curl
+{
+
+struct CurlHandlePoolStatistics
+{
+    uint64_t easyInits{0};   // handles created by curl_easy_init()
+    uint64_t reuses{0};      // handles taken from the pool instead
+    uint64_t releases{0};    // handles reset and put back into the pool
+    uint64_t cleanups{0};    // handles destroyed, because the pool was full or disabled
+    size_t pooledHandles{0};
+};
+
+// Recycles easy handles for CurlHolder: a released handle is reset with curl_easy_reset(), which drops all options, but keeps
+// the allocated handle with its own caches (TLS session IDs, cookies, alt-svc). Under the multi interface the connections and the
+// DNS cache belong to the multi handle or to a CurlShare, so they don't depend on the pool. The pool is disabled (max size 0) by default.
+class CurlHandlePool
+{
+public:
+    static CurlHandlePool &instance();
+
+    CurlHandlePool(const CurlHandlePool &other) = delete;
+    CurlHandlePool& operator=(const CurlHandlePool &other) = delete;
+
+    CURL *acquire();
+    void release(CURL *handle);
+
+    size_t maxSize() const;
+    void setMaxSize(size_t newMaxSize);
+
+    void clear(); // call this before curl_global_cleanup(), if the pool is enabled
+
+    CurlHandlePoolStatistics statistics() const;
+
+private:
+    CurlHandlePool() = default;
+    ~CurlHandlePool();
+
+    CURL *createHandle();
+
+    mutable std::mutex m_mutex;
+    std::vector<CURL*> m_handles;
+    size_t m_reservedSlots{0}; // for handles, which are reset outside of the lock
+    std::atomic<size_t> m_maxSize{0};
+
+    std::atomic<uint64_t> m_easyInits{0};
+    std::atomic<uint64_t> m_reuses{0};
+    std::atomic<uint64_t> m_releases{0};
+    std::atomic<uint64_t> m_cleanups{0};
+};
+
+}
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <curl/curl.h>
-#include <mutex>
 
 namespace curl
 {
@@ -15,11 +14,11 @@ public:
 
     CurlHolder& operator=(const CurlHolder &other) = delete;
 
+    bool duplicate(const CurlHolder &other); // replaces the handle by a copy of the other one with all of its options, but not its request headers
+    void swap(CurlHolder &other);
+
     CURL* handle{nullptr};
     struct curl_slist* requestHeader{nullptr};
-
-private:
-    static std::mutex& curl_easy_init_mutex();
 };
 
 }
@@ -1,45 +1,74 @@
 #pragma once
 
 #include "libcurl-wrapper/curlasynctransfer.hpp"
+#include "libcurl-wrapper/httpheaders.hpp"
+#include "libcurl-wrapper/responsesink.hpp"
+#include "libcurl-wrapper/uploadsource.hpp"
 
 namespace curl
 {
 
+enum class HttpVersion
+{
+    DEFAULT,                // libcurl decides: HTTP/2 over TLS, if the server offers it by ALPN, HTTP/1.1 otherwise
+    HTTP_1_1,
+    HTTP_2,                 // also for cleartext connections, by an upgrade from HTTP/1.1
+    HTTP_2_TLS,             // HTTP/2 over TLS only, HTTP/1.1 for cleartext connections
+    HTTP_2_PRIOR_KNOWLEDGE  // h2c without an upgrade: the server must speak HTTP/2
+};
+
 class CurlHttpTransfer : public CurlAsyncTransfer
 {
 public:
     explicit CurlHttpTransfer(const cu::Logger& logger);
     virtual ~CurlHttpTransfer() override = default; // Prevent undefined behavior when used as base class and delete per base class pointer
 
-    std::string responseHeader(const std::string &headerName);
-    std::unordered_map<std::string, std::string> &responseHeaders();
+    std::string_view responseHeader(std::string_view headerName) const; // empty, if the header doesn't exist; valid until the next transfer
+    const HttpHeaders &responseHeaders() const;
     std::vector<char> &responseData();
     void setOutputFilename(const std::string& fileNameWithPath);
+    void setResponseSink(std::shared_ptr<ResponseSink> newResponseSink); // replaces responseData() and the output file
 
     void setHeader(const std::string &name, const std::string &content);
     void clearHeaders();
 
     void setUploadFilename(const std::string& fileNameWithPath);
     void setPostData(const char *data,  long size = -1, bool copyData=false);
+    void setUploadSource(std::shared_ptr<UploadSource> newUploadSource); // POSTs the body pulled from the source; replaces the post data and the upload file
+
+    virtual bool isIdempotent() const override;                      // false for POST requests and uploads
+    virtual std::chrono::milliseconds retryAfter() const override;  // the Retry-After header in seconds; HTTP dates are not supported
 
     virtual void prepareTransfer() override;
+    virtual void finishTransfer() override;
     virtual void processResponse() override;
 
+    // Only idempotent transfers, which write into responseData(): a sink or an output file can't be shared by two running copies
+    virtual std::shared_ptr<CurlAsyncTransfer> _cloneForHedging() const override;
+    virtual void _adoptHedge(CurlAsyncTransfer &hedge) override;
+
     void setFollowRedirects(bool newFollowRedirects);
+    void setHttpVersion(HttpVersion httpVersion);
 
 private:
     static size_t staticOnWriteCallback(const char *ptr, size_t size, size_t nmemb, void *token);
-    void onWriteCallback(const char *ptr, size_t realsize);
+    bool onWriteCallback(const char *ptr, size_t realsize);
     static size_t staticOnHeaderCallback(const char *buffer, size_t size, size_t nitems, void *token);
     void onHeaderCallback(const char *buffer, size_t realsize);
+    static size_t staticOnReadCallback(char *buffer, size_t size, size_t nitems, void *token);
+    size_t onReadCallback(char *buffer, size_t capacity);
+    static int staticOnSeekCallback(void *token, curl_off_t offset, int origin);
 
-    std::unordered_map<std::string, std::string> m_responseHeaders;
+    HttpHeaders m_responseHeaders;
     std::vector<char> m_responseData;
     std::string m_outputFileName;
     std::ofstream m_outputFile;
+    std::shared_ptr<ResponseSink> m_responseSink;
     std::unordered_map<std::string, std::string> m_requestHeaders;
     std::string m_uploadFileName;
     FILE *m_uploadFileHandle{nullptr};
+    std::shared_ptr<UploadSource> m_uploadSource;
+    bool m_hasPostData{false};
     bool m_followRedirects{false};
 };
 
@@ -1,59 +1,287 @@
 #pragma once
 
+#include "bandwidthlimiter.hpp"
 #include "curlasynctransfer.hpp"
+#include "curlshare.hpp"
+#include "hedgingpolicy.hpp"
+#include "retrypolicy.hpp"
 #include "tracing.hpp"
 
 #include "cpp-utils/logging.hpp"
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
 #include <thread>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace curl
 {
 
+enum class EventLoop
+{
+    POLL,          // curl_multi_perform() + curl_multi_poll(): every wakeup walks all transfers
+    SOCKET_ACTION  // curl_multi_socket_action() driven by epoll/timerfd: every wakeup only handles the active sockets (Linux only)
+};
+
+enum class CompletionMode
+{
+    INLINE, // processResponse() and the TransferCallback run on the thread of the CurlMultiAsync
+    QUEUED  // finished transfers are queued; the application runs them with drainCompletions() from its own threads
+};
+
+struct PriorityStatistics
+{
+    size_t queuedTransfers{0};     // submitted, but not yet admitted to the multi stack
+    uint64_t admittedTransfers{0};
+    uint64_t totalWait_us{0};      // time between submission and admission of all admitted transfers
+    uint64_t maxWait_us{0};
+};
+
+// Multi handle options for the connections of one stack; the defaults are those of libcurl.
+// Without caps, N parallel HTTP/1.1 transfers to one host open N connections.
+struct ConnectionPolicy
+{
+    bool multiplex{true};            // CURLMOPT_PIPELINING: HTTP/2 transfers to the same host share one connection
+    bool pipeWait{false};            // CURLOPT_PIPEWAIT: wait for a connection, which may multiplex, instead of opening a new one
+    long maxHostConnections{0};      // CURLMOPT_MAX_HOST_CONNECTIONS: 0 = unlimited; further transfers wait inside libcurl
+    long maxTotalConnections{0};     // CURLMOPT_MAX_TOTAL_CONNECTIONS: 0 = unlimited
+    long maxCachedConnections{0};    // CURLMOPT_MAXCONNECTS: size of the connection cache; 0 = libcurl's default
+};
+
+// Wakes the threads, which wait in the waitFor...() calls; CurlMultiAsyncPool shares one between its workers
+struct WaitSignal
+{
+    std::mutex mutex; // the counters are changed without it, it only prevents lost wakeups
+    std::condition_variable condition;
+};
+
 class CurlMultiAsync
 {
 public:
-    explicit CurlMultiAsync(const cu::Logger& logger);
+    explicit CurlMultiAsync(const cu::Logger& logger, EventLoop eventLoop = EventLoop::POLL, CompletionMode completionMode = CompletionMode::INLINE);
     ~CurlMultiAsync();
 
     void performTransfer(std::shared_ptr<CurlAsyncTransfer> transfer);
+    std::future<AsyncResult> performTransferAsync(std::shared_ptr<CurlAsyncTransfer> transfer); // ready after the TransferCallback has run
     void cancelTransfer(std::shared_ptr<CurlAsyncTransfer> transfer);
     void cancelAllTransfers();
+    void resumeTransfer(std::shared_ptr<CurlAsyncTransfer> transfer); // after its UploadSource paused it: thread safe, ignored if the transfer doesn't run here
 
-    void waitForCompletion();
+    // Batch variants: the whole batch is queued under one lock and with one wakeup of the thread
+    void performTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers);
+    void cancelTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers);
+
+    // Event based waits: they return as soon as the condition is met, false means the deadline expired
+    using Deadline = std::chrono::steady_clock::time_point;
+    void waitForCompletion();                                                              // all transfers
+    bool waitForCompletion(Deadline deadline);                                             // all transfers
+    bool waitForAnyCompletion(Deadline deadline = Deadline::max());                        // the next completion after this call
+    bool waitForCompletedTransfers(uint64_t count, Deadline deadline = Deadline::max());   // until completedTransfers() reaches count
+    bool waitForStarted(Deadline deadline);                                                // until a transfer is running
     bool waitForStarted(uint32_t timeoutMs);
 
+    // Completions since construction: take it before submitting N transfers and wait for the value + N
+    uint64_t completedTransfers() const;
+
+    // CompletionMode::QUEUED: the eventfd is readable while completions are queued, so it can be added to the epoll loop of the application.
+    // drainCompletions() runs up to maxCompletions of them on the calling thread and may be called from several threads at once.
+    int completionFd() const;
+    size_t drainCompletions(size_t maxCompletions = std::numeric_limits<size_t>::max());
+    size_t queuedCompletions() const;
+
+    size_t activeTransfers() const;   // queued, running or waiting for completion; used by CurlMultiAsyncPool for load balancing
+    size_t runningTransfers() const;
+
     void setTraceConfiguration(std::shared_ptr<TraceConfigurationInterface> newTraceConfiguration);
 
+    // Admission control: transfers beyond these limits wait in one queue per TransferPriority and are admitted
+    // by priority, FIFO within a priority. A transfer waiting for a busy host doesn't block transfers to other hosts.
+    // 0 means unlimited (the default); set the per host limit before performing transfers.
+    void setMaxRunningTransfers(size_t newMaxRunningTransfers);
+    void setMaxTransfersPerHost(size_t newMaxTransfersPerHost);
+    PriorityStatistics priorityStatistics(TransferPriority priority) const;
+
+    // Transfers with a RetryPolicy wait in a timer heap of this thread during their backoff, no thread sleeps for them.
+    // They stay active until the last attempt has completed; canceling them also cancels a scheduled retry.
+    RetryStatistics retryStatistics() const;
+
+    // Applied by the thread before it handles the next transfers; it also survives a restart of the multi stack
+    ConnectionPolicy connectionPolicy() const;
+    void setConnectionPolicy(const ConnectionPolicy &newConnectionPolicy);
+
+    // Opt-in request hedging: a second copy of a slow request is started once the first one passes the latency percentile of its host.
+    // The histograms are measured by this stack; set the policy before performing transfers.
+    std::shared_ptr<HedgingPolicy> hedgingPolicy() const;
+    void setHedgingPolicy(std::shared_ptr<HedgingPolicy> newHedgingPolicy);
+    HedgingStatistics hedgingStatistics() const;
+
+    // Opt-in: share DNS, TLS sessions and connections between the transfers; like the trace configuration, set it before performing transfers
+    std::shared_ptr<CurlShare> share() const;
+    void setShare(std::shared_ptr<CurlShare> newShare);
+
+    // Opt-in: shapes the aggregate upload and download rate of all transfers of this stack; set it before performing transfers.
+    // Don't share one limiter between several CurlMultiAsync instances: its buckets are only used by one thread.
+    std::shared_ptr<BandwidthLimiter> bandwidthLimiter() const;
+    void setBandwidthLimiter(std::shared_ptr<BandwidthLimiter> newBandwidthLimiter);
+
+    // Used by CurlMultiAsyncPool right after construction, before any transfer could notify the old signal
+    void _shareWaitSignal(std::shared_ptr<WaitSignal> waitSignal);
+
 private:
     void threadedFunction(void);
 
+    bool initializeMultiStack();
+    void applyConnectionPolicy();
+    void createEventLoopDescriptors();
+    void closeEventLoopDescriptors();
+    void wakeupEventLoop();
+
     void handleQueues();
+    void admitPendingTransfers();
+    bool startTransfer(std::shared_ptr<CurlAsyncTransfer> transfer, std::string host);
+    bool cancelPendingTransfer(const std::shared_ptr<CurlAsyncTransfer> &transfer);
+    bool scheduleRetry(const std::shared_ptr<CurlAsyncTransfer> &transfer);
+    void queueDueRetries();
+    void scheduleHedge(const std::shared_ptr<CurlAsyncTransfer> &transfer, const std::string &host);
+    void startDueHedges();
+    bool resolveHedge(const std::shared_ptr<CurlAsyncTransfer> &transfer, AsyncResult asyncResult, CURLcode curlResult);
+    void cancelRunningHedge(const std::shared_ptr<CurlAsyncTransfer> &hedge);
+    void recordLatency(CURL *handle, const CurlAsyncTransfer &transfer);
     void handleMultiStackTransfers();
+    void handleSocketActionTransfers();
     void handleMultiStackMessages();
     void restartMultiStack();
+    int eventLoopTimeoutMs();
 
-    std::shared_ptr<CurlAsyncTransfer> getNextIncomingTransfer();
-    std::shared_ptr<CurlAsyncTransfer> getNextEleminatingTransfer();
+    static int staticOnSocketCallback(CURL *handle, curl_socket_t socket, int what, void *token, void *socketToken);
+    int onSocketCallback(curl_socket_t socket, int what);
+    static int staticOnTimerCallback(CURLM *multiHandle, long timeoutMs, void *token);
+    int onTimerCallback(long timeoutMs);
 
     std::shared_ptr<CurlAsyncTransfer> removeTransferFromRunningTransfers(CURL* transferHandle);
+    void removeHandleFromMultiStack(CURL *handle);
+    void finishTransfer(const std::shared_ptr<CurlAsyncTransfer> &transfer, AsyncResult asyncResult, CURLcode curlResult);
+    void queueCompletion(const std::shared_ptr<CurlAsyncTransfer> &transfer);
+    void transferCompleted();
+    void notifyWaiters();
+    template<typename Predicate> bool waitUntil(Deadline deadline, Predicate predicate);
 
     cu::Logger m_logger;
+    EventLoop m_eventLoop;
     std::atomic<bool> m_threadKeepRunning{true};
     std::unique_ptr<std::thread> m_thread;
     CURLM *m_multiHandle{nullptr};
 
-    std::mutex m_queueMutex;
+    // only used by EventLoop::SOCKET_ACTION
+    int m_epollFd{-1};
+    int m_timerFd{-1};
+    int m_wakeupFd{-1};  // eventfd: curl_multi_wakeup() only interrupts curl_multi_poll(), but not our own epoll_wait()
+
+    mutable std::mutex m_queueMutex; // only protects the three queues and the connection policy below and is never held during a perform pass
     std::queue<std::shared_ptr<CurlAsyncTransfer>> m_incomingTransfers;
     std::queue<std::shared_ptr<CurlAsyncTransfer>> m_eleminatingTransfers;
+    std::vector<std::shared_ptr<CurlAsyncTransfer>> m_resumingTransfers;
+    std::queue<std::shared_ptr<CurlAsyncTransfer>> m_takenIncomingTransfers;    // only used by the thread
+    std::queue<std::shared_ptr<CurlAsyncTransfer>> m_takenEleminatingTransfers; // only used by the thread
+    std::vector<std::shared_ptr<CurlAsyncTransfer>> m_takenResumingTransfers;   // only used by the thread
     std::atomic_bool m_cancelAllTransfers{false};
+    ConnectionPolicy m_connectionPolicy;
+    bool m_connectionPolicyChanged{false};
+    ConnectionPolicy m_appliedConnectionPolicy; // only used by the thread
+
+    std::unordered_map<CURL*, std::shared_ptr<CurlAsyncTransfer>> m_runningTransfers; // keyed by the easy handle, which is all that curl_multi_info_read() gives us
+    std::vector<std::pair<CURL*, CURLcode>> m_finishedHandles;                         // only used by handleMultiStackMessages(); kept to reuse its memory
+
+    struct PendingTransfer
+    {
+        std::shared_ptr<CurlAsyncTransfer> transfer;
+        std::string host; // only set with a per host limit
+    };
+
+    struct AtomicPriorityStatistics
+    {
+        std::atomic<size_t> queuedTransfers{0};
+        std::atomic<uint64_t> admittedTransfers{0};
+        std::atomic<uint64_t> totalWait_us{0};
+        std::atomic<uint64_t> maxWait_us{0};
+    };
+
+    std::array<std::deque<PendingTransfer>, transferPriorityCount> m_pendingTransfers; // only used by the thread
+    std::unordered_map<CURL*, std::string> m_runningTransferHosts;                      // only used by the thread
+    std::unordered_map<std::string, size_t> m_hostTransferCounts;                       // only used by the thread
+    std::atomic<size_t> m_maxRunningTransfers{0};
+    std::atomic<size_t> m_maxTransfersPerHost{0};
+    std::array<AtomicPriorityStatistics, transferPriorityCount> m_priorityStatistics;
+
+    struct ScheduledRetry
+    {
+        std::chrono::steady_clock::time_point due;
+        std::shared_ptr<CurlAsyncTransfer> transfer;
+
+        bool operator>(const ScheduledRetry &other) const { return due > other.due; } // with std::greater the heap has the next due retry at its front
+    };
+
+    struct AtomicRetryStatistics
+    {
+        std::atomic<uint64_t> attempts{0};
+        std::atomic<uint64_t> retries{0};
+        std::atomic<uint64_t> recoveredTransfers{0};
+        std::atomic<uint64_t> exhaustedTransfers{0};
+        std::atomic<uint64_t> nonIdempotentFailures{0};
+        std::atomic<size_t> scheduledRetries{0};
+    };
+
+    std::vector<ScheduledRetry> m_scheduledRetries; // min heap by due time; only used by the thread
+    AtomicRetryStatistics m_retryStatistics;
+
+    struct ScheduledHedge
+    {
+        std::chrono::steady_clock::time_point due;
+        std::shared_ptr<CurlAsyncTransfer> transfer;
+        uint64_t sequence; // only valid while the transfer is still a candidate with this sequence
+
+        bool operator>(const ScheduledHedge &other) const { return due > other.due; }
+    };
+
+    struct AtomicHedgingStatistics
+    {
+        std::atomic<uint64_t> hedgedTransfers{0};
+        std::atomic<uint64_t> hedgeWins{0};
+        std::atomic<uint64_t> skippedHedges{0};
+    };
+
+    // all only used by the thread
+    std::shared_ptr<HedgingPolicy> m_hedgingPolicy;
+    std::vector<ScheduledHedge> m_scheduledHedges;                                            // min heap by due time
+    std::unordered_map<CurlAsyncTransfer*, uint64_t> m_hedgeCandidates;                       // running originals with a scheduled hedge
+    std::unordered_map<CurlAsyncTransfer*, std::shared_ptr<CurlAsyncTransfer>> m_hedges;      // original -> running copy
+    std::unordered_map<CurlAsyncTransfer*, std::shared_ptr<CurlAsyncTransfer>> m_hedgeOrigins; // running copy -> original
+    std::unordered_set<CurlAsyncTransfer*> m_failedOriginals;                                  // failed, waiting for the result of their copy
+    std::unordered_map<std::string, LatencyHistogram> m_hostLatencies;
+    uint64_t m_hedgeSequence{0};
+    AtomicHedgingStatistics m_hedgingStatistics;
+    CompletionMode m_completionMode;
+    int m_completionFd{-1};
+    mutable std::mutex m_completionMutex;
+    std::queue<std::shared_ptr<CurlAsyncTransfer>> m_completions;
 
-    std::vector<std::shared_ptr<CurlAsyncTransfer>> m_runningTransfers;
+    std::atomic<size_t> m_activeTransferCount{0};
+    std::atomic<size_t> m_runningTransferCount{0};
+    std::atomic<uint64_t> m_completedTransferCount{0};
+    std::shared_ptr<WaitSignal> m_waitSignal{std::make_shared<WaitSignal>()};
     std::shared_ptr<TraceConfigurationInterface> m_traceConfiguration;
+    std::shared_ptr<CurlShare> m_share;
+    std::shared_ptr<BandwidthLimiter> m_bandwidthLimiter;
 
 };
 
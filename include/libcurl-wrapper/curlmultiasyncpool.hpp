@@ -0,0 +1,65 @@
+#pragma once
+
+#include "curlmultiasync.hpp"
+
+#include "cpp-utils/logging.hpp"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace curl
+{
+
+enum class ShardingStrategy
+{
+    LEAST_LOADED,  // new transfers go to the stack with the fewest queued and running transfers
+    HOST_AFFINITY  // all transfers to the same host go to the same stack, so they can share its connections
+};
+
+// Runs several CurlMultiAsync stacks, each one with its own thread and CURLM handle.
+// The interface mirrors CurlMultiAsync, so both can be used the same way.
+class CurlMultiAsyncPool
+{
+public:
+    explicit CurlMultiAsyncPool(const cu::Logger& logger, size_t workerCount = std::thread::hardware_concurrency(),
+                                ShardingStrategy shardingStrategy = ShardingStrategy::LEAST_LOADED, EventLoop eventLoop = EventLoop::POLL);
+
+    void performTransfer(std::shared_ptr<CurlAsyncTransfer> transfer);
+    std::future<AsyncResult> performTransferAsync(std::shared_ptr<CurlAsyncTransfer> transfer); // ready after the TransferCallback has run
+    void cancelTransfer(std::shared_ptr<CurlAsyncTransfer> transfer);
+    void cancelAllTransfers();
+    void resumeTransfer(std::shared_ptr<CurlAsyncTransfer> transfer);
+
+    void performTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers);
+    void cancelTransfers(const std::vector<std::shared_ptr<CurlAsyncTransfer>> &transfers);
+
+    void waitForCompletion();
+    bool waitForCompletion(CurlMultiAsync::Deadline deadline);
+    bool waitForStarted(CurlMultiAsync::Deadline deadline); // until a transfer is running on any worker
+    bool waitForStarted(uint32_t timeoutMs);
+
+    void setTraceConfiguration(std::shared_ptr<TraceConfigurationInterface> newTraceConfiguration);
+    void setShare(std::shared_ptr<CurlShare> newShare); // one share for all workers: CurlShare locks internally; throws, if it shares connections
+    void setConnectionPolicy(const ConnectionPolicy &newConnectionPolicy); // the connection caps apply to each worker
+
+    // The limits apply to each worker; with HOST_AFFINITY the per host limit is exact, because a host only ever uses one worker
+    void setMaxRunningTransfers(size_t newMaxRunningTransfers);
+    void setMaxTransfersPerHost(size_t newMaxTransfersPerHost);
+    PriorityStatistics priorityStatistics(TransferPriority priority) const; // summed up over all workers
+    RetryStatistics retryStatistics() const;                                // summed up over all workers; a retry stays on its worker
+
+    size_t workerCount() const;
+    size_t activeTransfers() const;
+
+private:
+    CurlMultiAsync &selectWorker(const CurlAsyncTransfer &transfer) const;
+    size_t selectWorkerIndex(const CurlAsyncTransfer &transfer, const std::vector<size_t> &load) const;
+
+    cu::Logger m_logger;
+    ShardingStrategy m_shardingStrategy;
+    std::vector<std::unique_ptr<CurlMultiAsync>> m_workers;
+    std::shared_ptr<WaitSignal> m_waitSignal; // shared by all workers, so one wait can watch all of them
+};
+
+}
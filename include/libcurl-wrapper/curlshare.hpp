@@ -0,0 +1,64 @@
+#pragma once
+
+#include "cpp-utils/logging.hpp"
+
+#include <curl/curl.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+namespace curl
+{
+
+struct CurlShareStatistics
+{
+    uint64_t reusedConnections{0};  // transfers without a new connection: hits of the connection cache
+    uint64_t newConnections{0};     // misses of the connection cache: each one needed a DNS lookup or hit the DNS cache
+    uint64_t tlsHandshakes{0};      // new connections with a TLS handshake (full or resumed from the shared session cache)
+    uint64_t lockAcquisitions{0};
+    uint64_t lockContentions{0};    // lock acquisitions, which had to wait for another thread
+};
+
+// Wraps a CURLSH handle, so DNS results, TLS sessions and the public suffix list can be reused by all transfers of one or more
+// CurlMultiAsync stacks, also across the threads of a CurlMultiAsyncPool.
+// Connections are opt-in: libcurl doesn't support sharing the connection cache between concurrent threads, so a share with
+// connections must only be used by stacks, which never run transfers at the same time. CurlMultiAsyncPool refuses it.
+class CurlShare
+{
+public:
+    explicit CurlShare(const cu::Logger& logger, bool shareDns = true, bool shareSslSessions = true, bool shareConnections = false, bool sharePsl = true);
+    CurlShare(const CurlShare &other) = delete;
+    ~CurlShare();
+
+    CurlShare& operator=(const CurlShare &other) = delete;
+
+    CURLSH *handle() const;
+    bool sharesConnections() const;
+
+    void recordTransfer(CURL *handle); // called from CurlMultiAsync after each finished transfer
+    CurlShareStatistics statistics() const;
+
+private:
+    void share(CURLSHoption option, curl_lock_data data);
+
+    static void staticOnLockCallback(CURL *handle, curl_lock_data data, curl_lock_access access, void *token);
+    void onLockCallback(curl_lock_data data);
+    static void staticOnUnlockCallback(CURL *handle, curl_lock_data data, void *token);
+    void onUnlockCallback(curl_lock_data data);
+
+    cu::Logger m_logger;
+    CURLSH *m_handle{nullptr};
+    bool m_sharesConnections{false};
+
+    // libcurl always asks for CURL_LOCK_ACCESS_SINGLE and the unlock callback doesn't tell the access type, so plain mutexes are sufficient
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> m_mutexes;
+
+    std::atomic<uint64_t> m_reusedConnections{0};
+    std::atomic<uint64_t> m_newConnections{0};
+    std::atomic<uint64_t> m_tlsHandshakes{0};
+    std::atomic<uint64_t> m_lockAcquisitions{0};
+    std::atomic<uint64_t> m_lockContentions{0};
+};
+
+}
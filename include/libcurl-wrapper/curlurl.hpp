@@ -21,6 +21,7 @@ public:
     bool fromString(const char *url, bool allowMissingScheme = false);
     bool fromString(const std::string &url, bool allowMissingScheme = false);
     std::string toString();
+    std::string host();
 
     bool setPath(const std::string &path, bool overwriteExisting = true);
     bool setPage(const std::string &page, bool overwriteExisting = true);
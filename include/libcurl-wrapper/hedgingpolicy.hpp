@@ -0,0 +1,39 @@
+#pragma once
+
+#include "latencyhistogram.hpp"
+
+#include <chrono>
+
+namespace curl
+{
+
+struct HedgingStatistics
+{
+    uint64_t hedgedTransfers{0}; // second copies started
+    uint64_t hedgeWins{0};       // the copy succeeded first or after the original had failed, and its result was taken
+    uint64_t skippedHedges{0};   // due, but the admission limits were reached
+};
+
+// Decides, when CurlMultiAsync sends a second copy of a slow request: once the first one runs longer than the
+// configured percentile of the latencies recently measured for its host. Whichever copy succeeds first wins;
+// if the original fails, it waits for the copy and takes its result.
+// Only for idempotent transfers, which can be copied (see CurlAsyncTransfer::_cloneForHedging()).
+class HedgingPolicy
+{
+public:
+    HedgingPolicy() = default;
+    virtual ~HedgingPolicy() = default; // Prevent undefined behavior when used as base class and delete per base class pointer
+
+    void setPercentile(double newPercentile);                  // default 0.95
+    void setMinSamples(uint64_t newMinSamples);                // no hedging before the host has this many samples; default 20
+    void setMinDelay(std::chrono::milliseconds newMinDelay);   // never hedge earlier; default 10 ms
+
+    virtual bool hedgeDelay(const LatencyHistogram &hostLatencies, std::chrono::microseconds &delay) const; // false: don't hedge
+
+private:
+    double m_percentile{0.95};
+    uint64_t m_minSamples{20};
+    std::chrono::milliseconds m_minDelay{10};
+};
+
+}
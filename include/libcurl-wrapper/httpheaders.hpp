@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace curl
+{
+
+// Splits a raw header line like "Content-Type: text/html\r\n" into name and value without allocating.
+// Returns false for lines without a header, e.g. the status line or the empty line at the end of the headers.
+bool parseHeaderLine(std::string_view line, std::string_view &name, std::string_view &value);
+
+// Extracts the version of a status line like "HTTP/1.1 200 OK\r\n"
+bool parseStatusLine(std::string_view line, std::string_view &httpVersion);
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+struct HttpHeader
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+// Response headers in one contiguous arena: names and values are appended as received and referenced by offsets.
+// The case insensitive index is only built on the first lookup or by buildIndex(). The arena grows on add(), so
+// string_views only stay valid until the next add() or clear(). Repeated headers (e.g. Set-Cookie) are all kept.
+// A lookup, which has to build the index, modifies the object: only after buildIndex() lookups may run concurrently.
+// CurlHttpTransfer calls it, when the transfer is finished.
+class HttpHeaders
+{
+    struct Entry
+    {
+        uint32_t nameOffset;
+        uint32_t nameSize;
+        uint32_t valueOffset;
+        uint32_t valueSize;
+    };
+
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = HttpHeader;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const HttpHeader*;
+        using reference         = HttpHeader;
+
+        Iterator(const HttpHeaders *headers, size_t position) : m_headers(headers), m_position(position) { }
+
+        HttpHeader operator*() const { return m_headers->header(m_headers->m_entries[m_position]); }
+        Iterator &operator++() { m_position++; return *this; }
+        bool operator!=(const Iterator &other) const { return m_position != other.m_position; }
+        bool operator==(const Iterator &other) const { return m_position == other.m_position; }
+
+    private:
+        const HttpHeaders *m_headers;
+        size_t m_position;
+    };
+
+    // All values of one header in the order they were received
+    class Values
+    {
+    public:
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = std::string_view;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const std::string_view*;
+            using reference         = std::string_view;
+
+            Iterator(const HttpHeaders *headers, const uint32_t *position) : m_headers(headers), m_position(position) { }
+
+            std::string_view operator*() const { return m_headers->header(m_headers->m_entries[*m_position]).value; }
+            Iterator &operator++() { m_position++; return *this; }
+            bool operator!=(const Iterator &other) const { return m_position != other.m_position; }
+            bool operator==(const Iterator &other) const { return m_position == other.m_position; }
+
+        private:
+            const HttpHeaders *m_headers;
+            const uint32_t *m_position;
+        };
+
+        Values(const HttpHeaders *headers, const uint32_t *first, const uint32_t *last) : m_headers(headers), m_first(first), m_last(last) { }
+
+        Iterator begin() const { return Iterator(m_headers, m_first); }
+        Iterator end() const { return Iterator(m_headers, m_last); }
+        size_t size() const { return m_last - m_first; }
+        bool empty() const { return m_first == m_last; }
+
+    private:
+        const HttpHeaders *m_headers;
+        const uint32_t *m_first;
+        const uint32_t *m_last;
+    };
+
+    void add(std::string_view name, std::string_view value);
+    void clear(); // keeps the allocated memory for the next response
+    void buildIndex();
+
+    bool contains(std::string_view name) const;
+    std::string_view value(std::string_view name) const; // the last received value; empty, if the header doesn't exist
+    Values values(std::string_view name) const;
+
+    size_t size() const;
+    bool empty() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    HttpHeader header(const Entry &entry) const;
+    std::string_view name(uint32_t entryIndex) const;
+    void updateIndex() const;
+
+    std::string m_arena;
+    std::vector<Entry> m_entries;
+
+    // entry indices sorted by the case insensitive name, entries with the same name in the order they were received
+    mutable std::vector<uint32_t> m_index;
+    mutable bool m_indexValid{false};
+};
+
+}
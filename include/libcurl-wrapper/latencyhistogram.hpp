@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace curl
+{
+
+// Log scale histogram of transfer latencies from 10 us to about 100 s with a resolution of 9% (8 buckets per doubling).
+// It forgets old samples: when maxSamples are reached, all buckets are halved, so the percentiles follow a changing backend.
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(uint64_t maxSamples = 1000);
+
+    void record(std::chrono::microseconds latency);
+    std::chrono::microseconds percentile(double percentile) const; // upper bound of the bucket; 0 without samples
+    uint64_t count() const;
+    void clear();
+
+private:
+    static constexpr size_t bucketCount = 192;
+
+    static size_t bucketIndex(std::chrono::microseconds latency);
+    static std::chrono::microseconds bucketUpperBound(size_t index);
+
+    std::array<uint64_t, bucketCount> m_buckets{};
+    uint64_t m_count{0};
+    uint64_t m_maxSamples;
+};
+
+}
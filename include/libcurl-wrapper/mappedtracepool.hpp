@@ -0,0 +1,108 @@
+#pragma once
+
+#include "cpp-utils/logging.hpp"
+#include "libcurl-wrapper/binarytracefile.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace curl
+{
+
+// Layout of a trace pool file (.ctp), all numbers little endian:
+//   file header (64 bytes): "CTP1", uint32 slot count, uint32 slot size
+//   slots:                  header (64 bytes): "CTS1", uint32 max data size, uint64 sequence (0: never used), uint64 transfer id,
+//                                              uint64 used bytes, uint64 dropped records
+//                           followed by the records of BinaryTraceFile (uncompressed)
+struct MappedTraceSlot
+{
+    uint32_t index{0};
+    uint64_t sequence{0};       // the higher, the more recent
+    uint64_t transferId{0};
+    uint32_t maxDataSize{0};
+    uint64_t droppedRecords{0}; // didn't fit into the slot anymore
+    std::vector<BinaryTraceRecord> records;
+};
+
+// One preallocated file, which is memory-mapped once and split into a fixed number of slots: each traced transfer takes the
+// next free slot and overwrites the oldest trace. Records are appended with memcpy into the shared mapping, without any syscall,
+// so the disk footprint is bounded and the kernel keeps the recent traces, when the process crashes.
+// Opening an existing file with the same geometry keeps its traces, until their slots are reused.
+class MappedTracePool
+{
+public:
+    MappedTracePool(const cu::Logger& logger, const std::string &filename, uint32_t slotCount = 64, uint32_t slotSize = 1024 * 1024); // throws
+    ~MappedTracePool();
+
+    MappedTracePool(const MappedTracePool&) = delete;
+    MappedTracePool &operator=(const MappedTracePool&) = delete;
+
+    const std::string &filename() const;
+    uint32_t slotCount() const;
+    uint32_t slotSize() const;
+    uint64_t skippedTransfers() const; // not traced, because all slots were in use
+
+    static std::vector<MappedTraceSlot> readSlots(const cu::Logger& logger, const std::string &filename); // oldest first; throws
+
+    // Used by MappedTraceFile: the slot belongs to the caller until it is released; nullptr if all slots are in use
+    char *_acquireSlot(uint64_t transferId, uint32_t maxDataSize, uint32_t &slotIndex);
+    void _releaseSlot(uint32_t slotIndex);
+
+private:
+    void mapFile();
+    void restoreCounters();
+
+    cu::Logger m_logger;
+    std::string m_filename;
+    uint32_t m_slotCount;
+    uint32_t m_slotSize;
+    int m_fd{-1};
+    char *m_mapping{nullptr};
+    size_t m_mappingSize{0};
+    std::unique_ptr<std::atomic<bool>[]> m_busySlots;
+    std::atomic<uint64_t> m_nextSlot{0};
+    std::atomic<uint64_t> m_nextSequence{1};
+    std::atomic<uint64_t> m_skippedTransfers{0};
+};
+
+// Trace of one transfer in a slot of a MappedTracePool
+class MappedTraceFile : public TracingInterface
+{
+public:
+    MappedTraceFile(const cu::Logger& logger, std::shared_ptr<MappedTracePool> pool);
+    virtual ~MappedTraceFile() override;
+
+    virtual void traceCurlDebugInfo(CURL *handle, curl_infotype type, char *data, size_t size) override;
+    virtual void traceMessage(std::string_view entry) override;
+
+    virtual void initialize() override;
+    virtual void finalize() override;
+
+    // Records, which were encoded with BinaryTraceFile::encodeRecordHeader before; their times are kept
+    void appendEncodedRecords(const char *records, size_t size);
+
+    uint32_t maxDataSize() const;
+    void setMaxDataSize(uint32_t newMaxDataSize);
+
+    void enableSslData(bool newEnableSslData);
+    void setTransferId(uint64_t newTransferId);
+
+private:
+    void appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize);
+
+    cu::Logger m_logger;
+    std::shared_ptr<MappedTracePool> m_pool;
+    char *m_slot{nullptr};
+    uint32_t m_slotIndex{0};
+    size_t m_used{0};
+    uint64_t m_droppedRecords{0};
+    uint32_t m_maxDataSize{0};
+    uint32_t m_dataSize{0};
+    bool m_enableSslData{false};
+    uint64_t m_transferId{0};
+    std::chrono::steady_clock::time_point m_timepointTransferBegin;
+};
+
+}
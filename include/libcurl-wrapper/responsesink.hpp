@@ -0,0 +1,101 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace curl
+{
+
+// Receives the response body of a CurlHttpTransfer chunk by chunk, directly from the libcurl write callback.
+// All functions are called from the thread of the CurlMultiAsync, which runs the transfer.
+class ResponseSink
+{
+public:
+    virtual ~ResponseSink() = default;
+
+    virtual void begin() { }                            // called before each transfer: drop the data of the previous one
+    virtual void sizeHint([[maybe_unused]] size_t size) { } // Content-Length, if the server sent one; untrusted, must not throw
+    virtual bool write(const char *data, size_t size) = 0;  // return false to abort the transfer (CURLE_WRITE_ERROR)
+    virtual void end() { }                              // called after the transfer, also if it failed
+};
+
+// Appends the data to a chain of chunks, so nothing is ever reallocated or copied a second time.
+// If the Content-Length is known, the first chunk is allocated with exactly this size, up to 16 MiB or the chunk size.
+class ChunkedBufferSink : public ResponseSink
+{
+public:
+    explicit ChunkedBufferSink(size_t chunkSize = 64 * 1024);
+
+    virtual void begin() override;
+    virtual void sizeHint(size_t size) override;
+    virtual bool write(const char *data, size_t size) override;
+
+    size_t size() const;
+    std::vector<std::string_view> chunks() const;
+    std::string toString() const; // copies all chunks into one contiguous string
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<char[]> data;
+        size_t capacity{0};
+        size_t size{0};
+    };
+
+    void appendChunk(size_t capacity);
+
+    size_t m_chunkSize;
+    size_t m_size{0};
+    std::vector<Chunk> m_chunks;
+};
+
+// Writes into a caller-provided buffer; the transfer is aborted, if the body doesn't fit
+class FixedBufferSink : public ResponseSink
+{
+public:
+    FixedBufferSink(char *buffer, size_t capacity);
+
+    virtual void begin() override;
+    virtual bool write(const char *data, size_t size) override;
+
+    size_t size() const;
+    bool overflow() const;
+    std::string_view data() const;
+
+private:
+    char *m_buffer;
+    size_t m_capacity;
+    size_t m_size{0};
+    bool m_overflow{false};
+};
+
+// Writes directly into a file descriptor (file, pipe or socket), which is owned by the caller
+class FileDescriptorSink : public ResponseSink
+{
+public:
+    explicit FileDescriptorSink(int fd);
+
+    virtual bool write(const char *data, size_t size) override;
+
+private:
+    int m_fd;
+};
+
+// Hands each chunk to a user callback, e.g. to feed a streaming parser or to forward the data
+using ResponseSinkCallback = std::function<bool (const char *data, size_t size)>;
+
+class CallbackSink : public ResponseSink
+{
+public:
+    explicit CallbackSink(const ResponseSinkCallback &callback);
+
+    virtual bool write(const char *data, size_t size) override;
+
+private:
+    ResponseSinkCallback m_callback;
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "curlasynctransfer.hpp"
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <set>
+
+namespace curl
+{
+
+struct RetryStatistics
+{
+    uint64_t attempts{0};              // started attempts, the first ones included
+    uint64_t retries{0};               // attempts scheduled by a RetryPolicy
+    uint64_t recoveredTransfers{0};    // completed without a retryable error after at least one retry
+    uint64_t exhaustedTransfers{0};    // completed with a retryable error, because all attempts were used up
+    uint64_t nonIdempotentFailures{0}; // completed with a retryable error, but not retried, because the request isn't idempotent
+    size_t scheduledRetries{0};        // currently waiting for their backoff to expire
+};
+
+// Decides, whether a finished transfer is submitted again and how long CurlMultiAsync waits before.
+// The backoff grows exponentially from the initial backoff up to the max backoff; the jitter randomizes a share of it,
+// so clients, which failed at the same time, don't retry at the same time.
+// Configure it before attaching it to transfers: one policy may be shared by all transfers, also across threads.
+class RetryPolicy
+{
+public:
+    RetryPolicy();
+    virtual ~RetryPolicy() = default; // Prevent undefined behavior when used as base class and delete per base class pointer
+
+    unsigned int maxAttempts() const;
+    void setMaxAttempts(unsigned int newMaxAttempts); // including the first attempt; default 3
+
+    void setBackoff(std::chrono::milliseconds initialBackoff, double multiplier = 2.0, std::chrono::milliseconds maxBackoff = std::chrono::seconds(30));
+    void setJitter(double newJitter); // 0.0 = none, 1.0 = full jitter; default 0.5
+
+    void setRetryOnTimeout(bool doRetryOnTimeout = true);           // AsyncResult TIMEOUT; default true
+    void setRetryNonIdempotent(bool doRetryNonIdempotent = true);   // e.g. POST requests; default false
+    void setRetryableCurlCodes(const std::set<CURLcode> &newRetryableCurlCodes);
+    void setRetryableResponseCodes(const std::set<long> &newRetryableResponseCodes);
+
+    virtual bool isRetryable(const CurlAsyncTransfer &transfer) const; // only looks at the result of the last attempt
+    bool shouldRetry(const CurlAsyncTransfer &transfer) const;          // isRetryable() + attempts + idempotency
+
+    virtual std::chrono::milliseconds backoff(unsigned int failedAttempt) const; // with jitter; failedAttempt starts at 1
+    std::chrono::milliseconds retryDelay(const CurlAsyncTransfer &transfer) const; // backoff(), but at least the Retry-After of the server
+
+private:
+    unsigned int m_maxAttempts{3};
+    std::chrono::milliseconds m_initialBackoff{100};
+    double m_multiplier{2.0};
+    std::chrono::milliseconds m_maxBackoff{30000};
+    double m_jitter{0.5};
+    bool m_retryOnTimeout{true};
+    bool m_retryNonIdempotent{false};
+    std::set<CURLcode> m_retryableCurlCodes;
+    std::set<long> m_retryableResponseCodes;
+};
+
+}
@@ -1,14 +1,25 @@
 #pragma once
 
 #include "cpp-utils/logging.hpp"
+#include "libcurl-wrapper/asynctracewriter.hpp"
+#include "libcurl-wrapper/conditionaltracecapture.hpp"
+#include "libcurl-wrapper/mappedtracepool.hpp"
 #include "libcurl-wrapper/tracing.hpp"
 
+#include <atomic>
+#include <mutex>
 #include <string>
 
 namespace curl
 {
 
-class TraceConfiguration : public TraceConfigurationInterface
+enum class TraceFormat
+{
+    TEXT,  // TraceFile or AsyncTraceFile: readable hexdumps (.ctf)
+    BINARY // BinaryTraceFile: raw records, rendered by the trace decoder tool (.ctb)
+};
+
+class TraceConfiguration : public TraceConfigurationInterface, public std::enable_shared_from_this<TraceConfiguration>
 {
 public:
     explicit TraceConfiguration(const cu::Logger& logger);
@@ -25,8 +36,25 @@ public:
     uint32_t rotationPoolSize() const;
     void setRotationPoolSize(uint32_t newRotationPoolSize);
 
+    void setTraceFormat(TraceFormat newTraceFormat);
+    void enableCompression(bool newEnableCompression); // zstd blocks for TraceFormat::BINARY, if available
+
+    // Opt-in: the trace files are written by this writer instead of synchronously in the libcurl debug callback
+    std::shared_ptr<AsyncTraceWriter> asyncTraceWriter() const;
+    void setAsyncTraceWriter(std::shared_ptr<AsyncTraceWriter> newAsyncTraceWriter);
+
+    // Opt-in: each transfer is traced into the next slot of this pool instead of a file of its own (takes precedence over the format)
+    std::shared_ptr<MappedTracePool> mappedTracePool() const;
+    void setMappedTracePool(std::shared_ptr<MappedTracePool> newMappedTracePool);
+
+    // Opt-in: every transfer is traced into memory, but only written, if the policy selects it, when the transfer is finished.
+    // enableTracing(n) counts the written traces then. The TraceConfiguration has to be owned by a std::shared_ptr.
+    void enableConditionalCapture(const TraceCapturePolicy &policy);
+    void disableConditionalCapture();
+
 private:
-    std::string generateNextFilename();
+    std::string generateNextFilename(const char *extension);
+    void writeCapturedTrace(uint64_t transferId, uint32_t maxDataSize, const std::vector<char> &records);
 
     cu::Logger m_logger;
     uint32_t m_maxDataSize{0};
@@ -35,7 +63,14 @@ private:
     std::string m_filenamePrefix{"curl_trace"};
     uint32_t m_rotationPoolSize{0};
     uint32_t m_nextRotationPoolIndex{0};
-    int32_t m_transfersToTrace{0};
+    std::atomic<int32_t> m_transfersToTrace{0};
+    std::shared_ptr<AsyncTraceWriter> m_asyncTraceWriter;
+    std::shared_ptr<MappedTracePool> m_mappedTracePool;
+    TraceFormat m_traceFormat{TraceFormat::TEXT};
+    bool m_enableCompression{false};
+    bool m_enableConditionalCapture{false};
+    TraceCapturePolicy m_capturePolicy;
+    std::mutex m_captureMutex; // captured traces are written by the threads, which finish the transfers
 };
 
 }
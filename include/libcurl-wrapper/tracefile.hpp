@@ -10,11 +10,24 @@
 namespace curl
 {
 
+enum class TracePayload
+{
+    DATA,      // text or hexdump of the data
+    HIDDEN,    // only the entry line: SSL data, unless it is enabled
+    TRUNCATED  // only the entry line and a note: the max data size is exceeded
+};
+
 class TraceFile : public TracingInterface
 {
 public:
     explicit TraceFile(const cu::Logger& logger);
 
+    // The format of the trace files, shared with AsyncTraceFile: the payload is decided on the transfer thread, so the data
+    // doesn't have to be copied, if it isn't written; the entry may be written later and on another thread
+    static TracePayload tracePayload(curl_infotype type, size_t size, bool enableSslData, uint32_t maxDataSize, uint32_t &dataSize);
+    static void writeCurlDebugInfo(std::ostream &stream, curl_infotype type, char *data, size_t size, std::chrono::milliseconds time,
+                                   TracePayload payload, uint32_t maxDataSize);
+
     virtual void traceCurlDebugInfo(CURL *handle, curl_infotype type, char *data, size_t size) override;
     virtual void traceMessage(std::string_view entry) override;
 
@@ -8,6 +8,7 @@
 namespace curl
 {
 
+class CurlAsyncTransfer;
 class TracingInterface
 {
 public:
@@ -18,9 +19,11 @@ public:
 
     virtual void initialize() = 0;
     virtual void finalize() = 0;
+
+    // Called before finalize(), when the result of the transfer is known
+    virtual void transferFinished([[maybe_unused]] CurlAsyncTransfer *transfer) {}
 };
 
-class CurlAsyncTransfer;
 class TraceConfigurationInterface
 {
 public:
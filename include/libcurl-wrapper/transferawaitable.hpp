@@ -0,0 +1,74 @@
+#pragma once
+
+#include "curlasynctransfer.hpp"
+
+// Only available, if the project is built with C++20 coroutines
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <functional>
+#include <memory>
+
+namespace curl
+{
+
+// Decides, where a suspended coroutine continues: it gets the resumption as task and runs it, e.g. in an event loop or thread pool
+using Executor = std::function<void (std::function<void ()> task)>;
+
+// co_await awaitTransfer(curlMultiAsync, transfer) submits the transfer and suspends the coroutine until the TransferCallback has run.
+// Works with CurlMultiAsync and CurlMultiAsyncPool. Without an executor, the coroutine is resumed directly on the thread of the
+// CurlMultiAsync (no thread hop): it must not block there, just like a TransferCallback.
+template<typename MultiAsync>
+class TransferAwaitable
+{
+public:
+    TransferAwaitable(MultiAsync &multiAsync, std::shared_ptr<CurlAsyncTransfer> transfer, Executor executor)
+        : m_multiAsync(multiAsync),
+          m_transfer(std::move(transfer)),
+          m_executor(std::move(executor))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine)
+    {
+        // the executor is copied: once the task is posted, this awaitable may be gone
+        m_transfer->_setCompletionHandler([this, coroutine, executor = m_executor](AsyncResult asyncResult)
+        {
+            m_asyncResult = asyncResult;
+
+            if(executor)
+                executor([coroutine]() { coroutine.resume(); });
+            else
+                coroutine.resume();
+        });
+
+        // don't touch any member after this: the coroutine may already run again on another thread
+        m_multiAsync.performTransfer(m_transfer);
+    }
+
+    AsyncResult await_resume() const noexcept
+    {
+        return m_asyncResult;
+    }
+
+private:
+    MultiAsync &m_multiAsync;
+    std::shared_ptr<CurlAsyncTransfer> m_transfer;
+    Executor m_executor;
+    AsyncResult m_asyncResult{NONE};
+};
+
+template<typename MultiAsync>
+TransferAwaitable<MultiAsync> awaitTransfer(MultiAsync &multiAsync, std::shared_ptr<CurlAsyncTransfer> transfer, Executor executor = Executor())
+{
+    return TransferAwaitable<MultiAsync>(multiAsync, std::move(transfer), std::move(executor));
+}
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <cstdint>
+#include <functional>
+
+namespace curl
+{
+
+// Provides the request body of a CurlHttpTransfer chunk by chunk: libcurl pulls it from the read callback.
+// All functions are called from the thread of the CurlMultiAsync, which runs the transfer.
+class UploadSource
+{
+public:
+    static constexpr size_t readPause = CURL_READFUNC_PAUSE; // no data yet: resume with CurlMultiAsync::resumeTransfer()
+    static constexpr size_t readAbort = CURL_READFUNC_ABORT; // aborts the transfer (CURLE_ABORTED_BY_CALLBACK)
+
+    virtual ~UploadSource() = default;
+
+    virtual int64_t size() const { return -1; }            // -1: unknown, the body is sent with chunked transfer encoding
+    virtual bool rewind() = 0;                             // start over: called before each attempt and for a redirect; false if not possible
+    virtual size_t read(char *buffer, size_t capacity) = 0; // bytes copied into the buffer, 0 at the end, readPause or readAbort
+    virtual void end() { }                                 // called after the transfer, also if it failed
+};
+
+// Sends a memory range, which is owned by the caller and must stay valid until the transfer is completed
+class MemoryUploadSource : public UploadSource
+{
+public:
+    MemoryUploadSource(const char *data, size_t size);
+
+    virtual int64_t size() const override;
+    virtual bool rewind() override;
+    virtual size_t read(char *buffer, size_t capacity) override;
+
+private:
+    const char *m_data;
+    size_t m_size;
+    size_t m_offset{0};
+};
+
+// Reads from a file descriptor (file, pipe or socket), which is owned by the caller.
+// Files are sent from the current offset on and can be rewound; pipes and sockets only, as long as nothing was read.
+// A nonblocking descriptor without data pauses the transfer: the producer resumes it after writing.
+class FileDescriptorUploadSource : public UploadSource
+{
+public:
+    explicit FileDescriptorUploadSource(int fd, int64_t size = -1); // -1: the remaining size of a regular file, otherwise unknown
+
+    virtual int64_t size() const override;
+    virtual bool rewind() override;
+    virtual size_t read(char *buffer, size_t capacity) override;
+
+private:
+    int m_fd;
+    int64_t m_size;
+    int64_t m_startOffset{-1}; // -1: not seekable
+    bool m_started{false};
+};
+
+// Hands the buffer to a user callback, e.g. to compress data straight into the request.
+// The generator returns the same as UploadSource::read(); without a rewind callback the body can only be sent once.
+using UploadGenerator = std::function<size_t (char *buffer, size_t capacity)>;
+using UploadRewind = std::function<bool ()>;
+
+class GeneratorUploadSource : public UploadSource
+{
+public:
+    explicit GeneratorUploadSource(const UploadGenerator &generator, const UploadRewind &rewind = nullptr, int64_t size = -1);
+
+    virtual int64_t size() const override;
+    virtual bool rewind() override;
+    virtual size_t read(char *buffer, size_t capacity) override;
+
+private:
+    UploadGenerator m_generator;
+    UploadRewind m_rewind;
+    int64_t m_size;
+    bool m_started{false};
+};
+
+}
@@ -0,0 +1,81 @@
+#include "libcurl-wrapper/latencyhistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace curl
+{
+
+namespace
+{
+
+constexpr double minLatency_us = 10.0;
+constexpr double bucketsPerDoubling = 8.0;
+
+}
+
+LatencyHistogram::LatencyHistogram(uint64_t maxSamples)
+    : m_maxSamples(std::max<uint64_t>(maxSamples, 2))
+{
+}
+
+void LatencyHistogram::record(std::chrono::microseconds latency)
+{
+    if(m_count >= m_maxSamples)
+    {
+        m_count = 0;
+        for(auto &bucket : m_buckets)
+        {
+            bucket /= 2;
+            m_count += bucket;
+        }
+    }
+
+    m_buckets[bucketIndex(latency)]++;
+    m_count++;
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double percentile) const
+{
+    if(m_count == 0)
+        return std::chrono::microseconds(0);
+
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 1.0) * m_count)));
+
+    uint64_t samples = 0;
+    for(size_t i = 0; i < bucketCount; i++)
+    {
+        samples += m_buckets[i];
+        if(samples >= target)
+            return bucketUpperBound(i);
+    }
+
+    return bucketUpperBound(bucketCount - 1);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+void LatencyHistogram::clear()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+}
+
+size_t LatencyHistogram::bucketIndex(std::chrono::microseconds latency)
+{
+    if(latency.count() <= minLatency_us)
+        return 0;
+
+    double index = std::ceil(bucketsPerDoubling * std::log2(latency.count() / minLatency_us));
+    return std::min(static_cast<size_t>(index), bucketCount - 1);
+}
+
+std::chrono::microseconds LatencyHistogram::bucketUpperBound(size_t index)
+{
+    return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(minLatency_us * std::exp2(index / bucketsPerDoubling)));
+}
+
+}
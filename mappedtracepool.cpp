@@ -0,0 +1,410 @@
+#include "libcurl-wrapper/mappedtracepool.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace curl
+{
+
+namespace
+{
+
+constexpr char fileMagic[4] = {'C', 'T', 'P', '1'};
+constexpr char slotMagic[4] = {'C', 'T', 'S', '1'};
+constexpr size_t fileHeaderSize = 64;
+constexpr size_t slotHeaderSize = 64;
+constexpr uint32_t minSlotSize = 4096;
+
+// Offsets in the slot header
+constexpr size_t slotMaxDataSize = 4;
+constexpr size_t slotSequence = 8;
+constexpr size_t slotTransferId = 16;
+constexpr size_t slotUsedBytes = 24;
+constexpr size_t slotDroppedRecords = 32;
+
+void storeU32(char *data, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void storeU64(char *data, uint64_t value)
+{
+    for(int i = 0; i < 8; i++)
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+uint32_t readU32(const char *data)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+uint64_t readU64(const char *data)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+}
+
+MappedTracePool::MappedTracePool(const cu::Logger &logger, const std::string &filename, uint32_t slotCount, uint32_t slotSize)
+    : m_logger(logger),
+      m_filename(filename),
+      m_slotCount(std::max<uint32_t>(slotCount, 1)),
+      m_slotSize((std::max(slotSize, minSlotSize) + 63) / 64 * 64),
+      m_busySlots(new std::atomic<bool>[m_slotCount])
+{
+    for(uint32_t i = 0; i < m_slotCount; i++)
+        m_busySlots[i] = false;
+
+    mapFile();
+    restoreCounters();
+}
+
+MappedTracePool::~MappedTracePool()
+{
+    if(m_mapping != nullptr)
+        munmap(m_mapping, m_mappingSize);
+
+    if(m_fd != -1)
+        close(m_fd);
+}
+
+const std::string &MappedTracePool::filename() const
+{
+    return m_filename;
+}
+
+uint32_t MappedTracePool::slotCount() const
+{
+    return m_slotCount;
+}
+
+uint32_t MappedTracePool::slotSize() const
+{
+    return m_slotSize;
+}
+
+uint64_t MappedTracePool::skippedTransfers() const
+{
+    return m_skippedTransfers;
+}
+
+void MappedTracePool::mapFile()
+{
+    m_mappingSize = fileHeaderSize + static_cast<size_t>(m_slotCount) * m_slotSize;
+
+    m_fd = open(m_filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(m_fd == -1)
+    {
+        std::string errMsg = fmt::format("failed to open trace pool {}: {}", m_filename, strerror(errno));
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    // Keep the traces of the last run, if the geometry is the same
+    char header[fileHeaderSize] = {};
+    struct stat fileStatus;
+    bool reuse = (fstat(m_fd, &fileStatus) == 0) && (static_cast<size_t>(fileStatus.st_size) == m_mappingSize) &&
+                 (pread(m_fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))) &&
+                 (std::memcmp(header, fileMagic, sizeof(fileMagic)) == 0) && (readU32(header + 4) == m_slotCount) && (readU32(header + 8) == m_slotSize);
+
+    if(!reuse)
+    {
+        // Allocate the blocks now: a full disk must not end in a SIGBUS, when a page of the mapping is written later
+        int result = (ftruncate(m_fd, 0) == 0) ? posix_fallocate(m_fd, 0, m_mappingSize) : errno;
+        if((result == EOPNOTSUPP) || (result == EINVAL))
+            result = (ftruncate(m_fd, m_mappingSize) == 0) ? 0 : errno; // e.g. tmpfs without fallocate support
+
+        if(result != 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+
+            std::string errMsg = fmt::format("failed to allocate {} bytes for trace pool {}: {}", m_mappingSize, m_filename, strerror(result));
+            m_logger->error(errMsg);
+            throw std::runtime_error(errMsg);
+        }
+    }
+
+    void *mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if(mapping == MAP_FAILED)
+    {
+        close(m_fd);
+        m_fd = -1;
+
+        std::string errMsg = fmt::format("failed to map trace pool {}: {}", m_filename, strerror(errno));
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+    m_mapping = static_cast<char *>(mapping);
+
+    if(!reuse)
+    {
+        std::memset(m_mapping, 0, fileHeaderSize);
+        std::memcpy(m_mapping, fileMagic, sizeof(fileMagic));
+        storeU32(m_mapping + 4, m_slotCount);
+        storeU32(m_mapping + 8, m_slotSize);
+    }
+
+    m_logger->info(fmt::format("trace pool {}: {} slots of {} bytes{}", m_filename, m_slotCount, m_slotSize, reuse ? ", keeping the traces of the last run" : ""));
+}
+
+void MappedTracePool::restoreCounters()
+{
+    // Continue after the most recent slot, so the oldest traces are overwritten first
+    uint64_t maxSequence = 0;
+    uint32_t maxSequenceSlot = m_slotCount - 1;
+
+    for(uint32_t i = 0; i < m_slotCount; i++)
+    {
+        const char *slot = m_mapping + fileHeaderSize + static_cast<size_t>(i) * m_slotSize;
+        if(std::memcmp(slot, slotMagic, sizeof(slotMagic)) != 0)
+            continue;
+
+        uint64_t sequence = readU64(slot + slotSequence);
+        if(sequence > maxSequence)
+        {
+            maxSequence = sequence;
+            maxSequenceSlot = i;
+        }
+    }
+
+    m_nextSequence = maxSequence + 1;
+    m_nextSlot = maxSequenceSlot + 1;
+}
+
+char *MappedTracePool::_acquireSlot(uint64_t transferId, uint32_t maxDataSize, uint32_t &slotIndex)
+{
+    // Skip slots, which are still written by long running transfers
+    for(uint32_t attempt = 0; attempt < m_slotCount; attempt++)
+    {
+        uint32_t index = static_cast<uint32_t>(m_nextSlot++ % m_slotCount);
+
+        bool expected = false;
+        if(!m_busySlots[index].compare_exchange_strong(expected, true))
+            continue;
+
+        char *slot = m_mapping + fileHeaderSize + static_cast<size_t>(index) * m_slotSize;
+
+        // The sequence is written last: a reader never takes the records of the previous trace for this one
+        storeU64(slot + slotSequence, 0);
+        std::atomic_signal_fence(std::memory_order_release);
+        std::memcpy(slot, slotMagic, sizeof(slotMagic));
+        storeU32(slot + slotMaxDataSize, maxDataSize);
+        storeU64(slot + slotTransferId, transferId);
+        storeU64(slot + slotUsedBytes, 0);
+        storeU64(slot + slotDroppedRecords, 0);
+        std::atomic_signal_fence(std::memory_order_release);
+        storeU64(slot + slotSequence, m_nextSequence++);
+
+        slotIndex = index;
+        return slot;
+    }
+
+    m_skippedTransfers++;
+    return nullptr;
+}
+
+void MappedTracePool::_releaseSlot(uint32_t slotIndex)
+{
+    if(slotIndex < m_slotCount)
+        m_busySlots[slotIndex] = false;
+}
+
+std::vector<MappedTraceSlot> MappedTracePool::readSlots(const cu::Logger &logger, const std::string &filename)
+{
+    auto fail = [&](const std::string &message)
+    {
+        std::string errMsg = fmt::format("trace pool {}: {}", filename, message);
+        logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    };
+
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        fail("failed to open");
+
+    struct stat fileStatus;
+    void *mapping = MAP_FAILED;
+    if((fstat(fd, &fileStatus) == 0) && (static_cast<size_t>(fileStatus.st_size) >= fileHeaderSize))
+        mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED)
+        fail("not a trace pool");
+
+    const char *data = static_cast<const char *>(mapping);
+    size_t size = fileStatus.st_size;
+    uint32_t slotCount = readU32(data + 4);
+    uint32_t slotSize = readU32(data + 8);
+
+    if((std::memcmp(data, fileMagic, sizeof(fileMagic)) != 0) || (slotSize < minSlotSize) ||
+       (size != fileHeaderSize + static_cast<size_t>(slotCount) * slotSize))
+    {
+        munmap(mapping, size);
+        fail("not a trace pool");
+    }
+
+    std::vector<MappedTraceSlot> slots;
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        const char *slot = data + fileHeaderSize + static_cast<size_t>(i) * slotSize;
+        uint64_t sequence = readU64(slot + slotSequence);
+        if((std::memcmp(slot, slotMagic, sizeof(slotMagic)) != 0) || (sequence == 0))
+            continue;
+
+        MappedTraceSlot traceSlot;
+        traceSlot.index = i;
+        traceSlot.sequence = sequence;
+        traceSlot.transferId = readU64(slot + slotTransferId);
+        traceSlot.maxDataSize = readU32(slot + slotMaxDataSize);
+        traceSlot.droppedRecords = readU64(slot + slotDroppedRecords);
+
+        // A crash may leave a record behind the used bytes: only complete records count
+        size_t used = std::min<size_t>(readU64(slot + slotUsedBytes), slotSize - slotHeaderSize);
+        size_t offset = 0;
+        BinaryTraceRecord record;
+        while(BinaryTraceReader::decodeRecord(slot + slotHeaderSize, used, offset, record))
+            traceSlot.records.push_back(record);
+
+        slots.push_back(std::move(traceSlot));
+    }
+
+    munmap(mapping, size);
+
+    std::sort(slots.begin(), slots.end(), [](const MappedTraceSlot &a, const MappedTraceSlot &b) { return a.sequence < b.sequence; });
+    return slots;
+}
+
+MappedTraceFile::MappedTraceFile(const cu::Logger &logger, std::shared_ptr<MappedTracePool> pool)
+    : m_logger(logger),
+      m_pool(std::move(pool))
+{
+
+}
+
+MappedTraceFile::~MappedTraceFile()
+{
+    finalize();
+}
+
+void MappedTraceFile::initialize()
+{
+    finalize(); // a transfer, which is traced again, takes a new slot
+
+    m_slot = m_pool->_acquireSlot(m_transferId, m_maxDataSize, m_slotIndex);
+    if(m_slot == nullptr)
+        m_logger->warning(fmt::format("all {} slots of trace pool {} are in use: transfer {} isn't traced", m_pool->slotCount(), m_pool->filename(), m_transferId));
+
+    m_used = 0;
+    m_droppedRecords = 0;
+    m_dataSize = 0;
+    m_timepointTransferBegin = std::chrono::steady_clock::now();
+}
+
+void MappedTraceFile::finalize()
+{
+    if(m_slot == nullptr)
+        return;
+
+    m_pool->_releaseSlot(m_slotIndex);
+    m_slot = nullptr;
+}
+
+void MappedTraceFile::traceCurlDebugInfo([[maybe_unused]] CURL *handle, curl_infotype type, char *data, size_t size)
+{
+    if(m_slot == nullptr)
+        return;
+
+    TracePayload payload = TraceFile::tracePayload(type, size, m_enableSslData, m_maxDataSize, m_dataSize);
+    appendRecord(BinaryTraceRecordKind::CURL_DEBUG_INFO, type, payload, size, data, (payload == TracePayload::DATA) ? size : 0);
+}
+
+void MappedTraceFile::traceMessage(std::string_view entry)
+{
+    if(m_slot == nullptr)
+        return;
+
+    appendRecord(BinaryTraceRecordKind::MESSAGE, CURLINFO_TEXT, TracePayload::DATA, entry.size(), entry.data(), entry.size());
+}
+
+void MappedTraceFile::appendRecord(BinaryTraceRecordKind kind, curl_infotype type, TracePayload payload, size_t size, const char *data, size_t dataSize)
+{
+    size_t recordSize = BinaryTraceFile::recordHeaderSize + dataSize;
+    if(recordSize > m_pool->slotSize() - slotHeaderSize - m_used)
+    {
+        storeU64(m_slot + slotDroppedRecords, ++m_droppedRecords);
+        return;
+    }
+
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_timepointTransferBegin);
+    char *record = m_slot + slotHeaderSize + m_used;
+    BinaryTraceFile::encodeRecordHeader(record, kind, type, payload, size, time, m_transferId, dataSize);
+    std::memcpy(record + BinaryTraceFile::recordHeaderSize, data, dataSize);
+
+    // The used bytes are written after the record: after a crash, the last record is either complete or ignored
+    m_used += recordSize;
+    std::atomic_signal_fence(std::memory_order_release);
+    storeU64(m_slot + slotUsedBytes, m_used);
+}
+
+void MappedTraceFile::appendEncodedRecords(const char *records, size_t size)
+{
+    if(m_slot == nullptr)
+        return;
+
+    size_t offset = 0;
+    while(size - offset >= 4)
+    {
+        size_t recordSize = 4 + readU32(records + offset);
+        if(recordSize > size - offset)
+            break;
+
+        if(recordSize > m_pool->slotSize() - slotHeaderSize - m_used)
+            storeU64(m_slot + slotDroppedRecords, ++m_droppedRecords);
+        else
+        {
+            std::memcpy(m_slot + slotHeaderSize + m_used, records + offset, recordSize);
+            m_used += recordSize;
+            std::atomic_signal_fence(std::memory_order_release);
+            storeU64(m_slot + slotUsedBytes, m_used);
+        }
+
+        offset += recordSize;
+    }
+}
+
+uint32_t MappedTraceFile::maxDataSize() const
+{
+    return m_maxDataSize;
+}
+
+void MappedTraceFile::setMaxDataSize(uint32_t newMaxDataSize)
+{
+    m_maxDataSize = newMaxDataSize;
+}
+
+void MappedTraceFile::enableSslData(bool newEnableSslData)
+{
+    m_enableSslData = newEnableSslData;
+}
+
+void MappedTraceFile::setTransferId(uint64_t newTransferId)
+{
+    m_transferId = newTransferId;
+}
+
+}
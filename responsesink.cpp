@@ -0,0 +1,188 @@
+#include "libcurl-wrapper/responsesink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <unistd.h>
+
+namespace curl
+{
+
+namespace
+{
+
+// The Content-Length comes from the server: a larger first chunk is not worth trusting it
+constexpr size_t maxSizeHint = 16 * 1024 * 1024;
+
+}
+
+ChunkedBufferSink::ChunkedBufferSink(size_t chunkSize)
+    : m_chunkSize(std::max<size_t>(chunkSize, 1))
+{
+
+}
+
+void ChunkedBufferSink::begin()
+{
+    m_chunks.clear();
+    m_size = 0;
+}
+
+void ChunkedBufferSink::sizeHint(size_t size)
+{
+    // only useful before the first byte arrived
+    if(!m_chunks.empty() || (size == 0))
+        return;
+
+    // Called from the header callback: no exception may pass through libcurl, write() allocates again if needed
+    try
+    {
+        appendChunk(std::min(size, std::max(m_chunkSize, maxSizeHint)));
+    }
+    catch(const std::bad_alloc&)
+    {
+        m_chunks.clear();
+    }
+}
+
+bool ChunkedBufferSink::write(const char *data, size_t size)
+{
+    while(size > 0)
+    {
+        if(m_chunks.empty() || (m_chunks.back().size == m_chunks.back().capacity))
+            appendChunk(std::max(m_chunkSize, size));
+
+        Chunk &chunk = m_chunks.back();
+        size_t bytes = std::min(size, chunk.capacity - chunk.size);
+        std::memcpy(chunk.data.get() + chunk.size, data, bytes);
+
+        chunk.size += bytes;
+        m_size += bytes;
+        data += bytes;
+        size -= bytes;
+    }
+
+    return true;
+}
+
+size_t ChunkedBufferSink::size() const
+{
+    return m_size;
+}
+
+std::vector<std::string_view> ChunkedBufferSink::chunks() const
+{
+    std::vector<std::string_view> chunks;
+    chunks.reserve(m_chunks.size());
+
+    for(const auto &chunk : m_chunks)
+    {
+        if(chunk.size > 0)
+            chunks.emplace_back(chunk.data.get(), chunk.size);
+    }
+
+    return chunks;
+}
+
+std::string ChunkedBufferSink::toString() const
+{
+    std::string result;
+    result.reserve(m_size);
+
+    for(const auto &chunk : m_chunks)
+        result.append(chunk.data.get(), chunk.size);
+
+    return result;
+}
+
+void ChunkedBufferSink::appendChunk(size_t capacity)
+{
+    Chunk chunk;
+    chunk.data.reset(new char[capacity]);
+    chunk.capacity = capacity;
+    m_chunks.push_back(std::move(chunk));
+}
+
+FixedBufferSink::FixedBufferSink(char *buffer, size_t capacity)
+    : m_buffer(buffer),
+      m_capacity(capacity)
+{
+
+}
+
+void FixedBufferSink::begin()
+{
+    m_size = 0;
+    m_overflow = false;
+}
+
+bool FixedBufferSink::write(const char *data, size_t size)
+{
+    if(size > m_capacity - m_size)
+    {
+        m_overflow = true;
+        return false;
+    }
+
+    std::memcpy(m_buffer + m_size, data, size);
+    m_size += size;
+    return true;
+}
+
+size_t FixedBufferSink::size() const
+{
+    return m_size;
+}
+
+bool FixedBufferSink::overflow() const
+{
+    return m_overflow;
+}
+
+std::string_view FixedBufferSink::data() const
+{
+    return std::string_view(m_buffer, m_size);
+}
+
+FileDescriptorSink::FileDescriptorSink(int fd)
+    : m_fd(fd)
+{
+
+}
+
+bool FileDescriptorSink::write(const char *data, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t written = ::write(m_fd, data, size);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+CallbackSink::CallbackSink(const ResponseSinkCallback &callback)
+    : m_callback(callback)
+{
+
+}
+
+bool CallbackSink::write(const char *data, size_t size)
+{
+    if(!m_callback)
+        return false;
+
+    return m_callback(data, size);
+}
+
+}
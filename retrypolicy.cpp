@@ -0,0 +1,111 @@
+#include "libcurl-wrapper/retrypolicy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace curl
+{
+
+RetryPolicy::RetryPolicy()
+    // Errors, after which the same request may well succeed: the connection or the server had a problem, not the request
+    : m_retryableCurlCodes{CURLE_COULDNT_RESOLVE_HOST, CURLE_COULDNT_CONNECT, CURLE_OPERATION_TIMEDOUT, CURLE_SEND_ERROR,
+                           CURLE_RECV_ERROR, CURLE_GOT_NOTHING, CURLE_PARTIAL_FILE, CURLE_HTTP2, CURLE_HTTP2_STREAM, CURLE_SSL_CONNECT_ERROR},
+      m_retryableResponseCodes{408, 429, 500, 502, 503, 504}
+{
+}
+
+unsigned int RetryPolicy::maxAttempts() const
+{
+    return m_maxAttempts;
+}
+
+void RetryPolicy::setMaxAttempts(unsigned int newMaxAttempts)
+{
+    m_maxAttempts = std::max(newMaxAttempts, 1u);
+}
+
+void RetryPolicy::setBackoff(std::chrono::milliseconds initialBackoff, double multiplier, std::chrono::milliseconds maxBackoff)
+{
+    m_initialBackoff = initialBackoff;
+    m_multiplier = std::max(multiplier, 1.0);
+    m_maxBackoff = std::max(maxBackoff, initialBackoff);
+}
+
+void RetryPolicy::setJitter(double newJitter)
+{
+    m_jitter = std::clamp(newJitter, 0.0, 1.0);
+}
+
+void RetryPolicy::setRetryOnTimeout(bool doRetryOnTimeout)
+{
+    m_retryOnTimeout = doRetryOnTimeout;
+}
+
+void RetryPolicy::setRetryNonIdempotent(bool doRetryNonIdempotent)
+{
+    m_retryNonIdempotent = doRetryNonIdempotent;
+}
+
+void RetryPolicy::setRetryableCurlCodes(const std::set<CURLcode> &newRetryableCurlCodes)
+{
+    m_retryableCurlCodes = newRetryableCurlCodes;
+}
+
+void RetryPolicy::setRetryableResponseCodes(const std::set<long> &newRetryableResponseCodes)
+{
+    m_retryableResponseCodes = newRetryableResponseCodes;
+}
+
+bool RetryPolicy::isRetryable(const CurlAsyncTransfer &transfer) const
+{
+    switch(transfer.asyncResult())
+    {
+    case TIMEOUT:
+        return m_retryOnTimeout;
+
+    case CURL_DONE:
+        if(transfer.curlResult() != CURLE_OK)
+            return m_retryableCurlCodes.count(transfer.curlResult()) > 0;
+
+        return m_retryableResponseCodes.count(transfer.responseCode()) > 0;
+
+    default:
+        return false; // never retry canceled transfers
+    }
+}
+
+bool RetryPolicy::shouldRetry(const CurlAsyncTransfer &transfer) const
+{
+    if(transfer.attempts() >= m_maxAttempts)
+        return false;
+
+    if(!m_retryNonIdempotent && !transfer.isIdempotent())
+        return false;
+
+    return isRetryable(transfer);
+}
+
+std::chrono::milliseconds RetryPolicy::backoff(unsigned int failedAttempt) const
+{
+    double backoff_ms = m_initialBackoff.count() * std::pow(m_multiplier, std::max(failedAttempt, 1u) - 1);
+    backoff_ms = std::min(backoff_ms, static_cast<double>(m_maxBackoff.count()));
+
+    if(m_jitter > 0.0)
+    {
+        // Each thread gets its own engine, so a shared policy needs no lock
+        thread_local std::mt19937 randomEngine{std::random_device{}()};
+        std::uniform_real_distribution<double> distribution(1.0 - m_jitter, 1.0);
+        backoff_ms *= distribution(randomEngine);
+    }
+
+    return std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(backoff_ms));
+}
+
+std::chrono::milliseconds RetryPolicy::retryDelay(const CurlAsyncTransfer &transfer) const
+{
+    // The server knows best, but a misbehaving one must not stall the transfer forever
+    return std::max(backoff(transfer.attempts()), std::min(transfer.retryAfter(), m_maxBackoff));
+}
+
+}
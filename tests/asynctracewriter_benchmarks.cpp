@@ -0,0 +1,81 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/asynctracewriter.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/traceconfiguration.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+// Download throughput of parallel transfers without tracing, with TraceFile (formatted and flushed in the debug callback)
+// and with AsyncTraceFile (copied into the ring of an AsyncTraceWriter)
+TEST(AsyncTraceWriterBenchmark, TracingThroughput)
+{
+    const int transferCount = 32;
+    const size_t bodySize = 1024 * 1024;
+    const std::string filenamePrefix = "libcurl-wrapper-trace-benchmark";
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = std::string(bodySize, 'x');
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    enum class Tracing { OFF, TRACE_FILE, ASYNC_TRACE_FILE };
+    for(auto tracing : {Tracing::OFF, Tracing::TRACE_FILE, Tracing::ASYNC_TRACE_FILE})
+    {
+        std::shared_ptr<curl::AsyncTraceWriter> writer;
+        auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+        traceConfiguration->setFilenamePrefix(filenamePrefix);
+        traceConfiguration->setRotationPoolSize(transferCount);
+        if(tracing != Tracing::OFF)
+            traceConfiguration->enableTracing(transferCount);
+        if(tracing == Tracing::ASYNC_TRACE_FILE)
+        {
+            writer = std::make_shared<curl::AsyncTraceWriter>(logger, 16384);
+            traceConfiguration->setAsyncTraceWriter(writer);
+        }
+
+        curl::CurlMultiAsync curlMultiAsync(logger);
+        curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        for(int i = 0; i < transferCount; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/trace-benchmark");
+            transfers.push_back(transfer);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        curlMultiAsync.performTransfers(transfers);
+        curlMultiAsync.waitForCompletion();
+        std::chrono::duration<double> transferDuration = std::chrono::steady_clock::now() - begin;
+
+        // The writer may still be busy: that doesn't slow down the transfers, but is reported separately
+        if(writer)
+            writer->flush();
+        std::chrono::duration<double> writeDuration = std::chrono::steady_clock::now() - begin;
+
+        for(const auto &transfer : transfers)
+            EXPECT_EQ(transfer->responseCode(), 200);
+
+        std::string name = (tracing == Tracing::OFF) ? "no tracing     " : ((tracing == Tracing::TRACE_FILE) ? "TraceFile      " : "AsyncTraceFile ");
+        std::cout << fmt::format("{}: {:7.1f} MiB/s, transfers {:.3f} s, traces written after {:.3f} s, {} entries dropped",
+                                 name, transferCount * bodySize / (1024.0 * 1024.0) / transferDuration.count(), transferDuration.count(),
+                                 writeDuration.count(), writer ? writer->droppedEntries() : 0) << std::endl;
+
+        for(int i = 0; i < transferCount; i++)
+            unlink(fmt::format("/tmp/{}_{}.ctf", filenamePrefix, i).c_str());
+    }
+}
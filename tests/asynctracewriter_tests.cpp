@@ -0,0 +1,108 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/asynctracewriter.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/traceconfiguration.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+std::string readFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+}
+
+TEST(AsyncTraceWriter, TraceTransfers)
+{
+    const int transferCount = 4;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto writer = std::make_shared<curl::AsyncTraceWriter>(logger);
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setAsyncTraceWriter(writer);
+    traceConfiguration->setFilenamePrefix("libcurl-wrapper-async-trace-test");
+    traceConfiguration->setRotationPoolSize(transferCount);
+    traceConfiguration->enableTracing(transferCount);
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < transferCount; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/trace-url");
+        transfers.push_back(transfer);
+    }
+
+    curlMultiAsync.performTransfers(transfers);
+    curlMultiAsync.waitForCompletion();
+    writer->flush();
+
+    EXPECT_GT(writer->writtenEntries(), transferCount * 5);
+    EXPECT_EQ(writer->droppedEntries(), 0);
+
+    for(int i = 0; i < transferCount; i++)
+    {
+        std::string filename = fmt::format("/tmp/libcurl-wrapper-async-trace-test_{}.ctf", i);
+        std::string trace = readFile(filename);
+        unlink(filename.c_str());
+
+        EXPECT_THAT(trace, testing::StartsWith("### Timestamp: "));
+        EXPECT_THAT(trace, testing::HasSubstr("### HDR_OUT: "));
+        EXPECT_THAT(trace, testing::HasSubstr("GET /trace-url HTTP/1.1"));
+        EXPECT_THAT(trace, testing::HasSubstr("### DATA_IN: 8 bytes, time "));
+        EXPECT_THAT(trace, testing::EndsWith("### Response Code: 200 ###\n"));
+    }
+}
+
+TEST(AsyncTraceWriter, DropAndCount)
+{
+    const int entryCount = 10000;
+    std::string filename = "/tmp/libcurl-wrapper-async-trace-drop-test.ctf";
+    std::vector<char> data(16 * 1024, 'x');
+
+    auto writer = std::make_shared<curl::AsyncTraceWriter>(logger, 4);
+
+    // The payloads are hexdumped on the writer thread, which can't keep up with the ring of 4 entries
+    auto traceFile = std::make_unique<curl::AsyncTraceFile>(logger, writer);
+    traceFile->setFilename(filename);
+    traceFile->initialize();
+    for(int i = 0; i < entryCount; i++)
+        traceFile->traceCurlDebugInfo(nullptr, CURLINFO_DATA_IN, data.data(), data.size());
+    traceFile->finalize();
+    writer->flush();
+
+    EXPECT_GT(writer->droppedEntries(), 0);
+    EXPECT_EQ(traceFile->droppedEntries(), writer->droppedEntries());
+    EXPECT_EQ(writer->writtenEntries() + writer->droppedEntries(), entryCount);
+
+    // The file tells where entries are missing
+    std::string trace = readFile(filename);
+    unlink(filename.c_str());
+    EXPECT_THAT(trace, testing::HasSubstr(" trace entries dropped ###"));
+}
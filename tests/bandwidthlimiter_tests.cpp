@@ -0,0 +1,185 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/bandwidthlimiter.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <thread>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+constexpr uint64_t rateBytesPerSecond = 1024 * 1024;
+constexpr size_t transferSize = 1024 * 1024;
+
+}
+
+TEST(BandwidthLimiter, AggregateDownloadRate)
+{
+    for(auto eventLoop : {curl::EventLoop::POLL, curl::EventLoop::SOCKET_ACTION})
+    {
+        httpmock::HttpMockServer mockServer(port);
+        mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+        {
+            connectionData->responseCode = 200;
+            connectionData->responseBody = std::string(transferSize, 'x');
+        });
+
+        mockServer.start();
+        EXPECT_TRUE(mockServer.isRunning());
+
+        curl::CurlMultiAsync curlMultiAsync(logger, eventLoop);
+        curlMultiAsync.setBandwidthLimiter(std::make_shared<curl::BandwidthLimiter>(0, rateBytesPerSecond));
+
+        // HIGH gets 4/5 of the rate while both run, so it must finish first although it is started last
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        std::vector<curl::TransferPriority> finishOrder;
+        for(auto priority : {curl::TransferPriority::BULK, curl::TransferPriority::HIGH})
+        {
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+            transfer->setPriority(priority);
+            transfer->setTransferCallback([&finishOrder](curl::CurlAsyncTransfer *transfer) { finishOrder.push_back(transfer->priority()); });
+            transfers.push_back(transfer);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        curlMultiAsync.performTransfers(transfers);
+        curlMultiAsync.waitForCompletion();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        uint64_t transferredBytes = 0;
+        for(const auto &transfer : transfers)
+        {
+            EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+            EXPECT_EQ(transfer->responseCode(), 200);
+            transferredBytes += transfer->transferredBytes();
+        }
+
+        EXPECT_EQ(transferredBytes, 2 * transferSize);
+        double rate = transferredBytes / elapsed.count();
+        EXPECT_NEAR(rate, rateBytesPerSecond, rateBytesPerSecond * 0.05) << fmt::format("elapsed {:.3f} s", elapsed.count());
+        EXPECT_THAT(finishOrder, testing::ElementsAre(curl::TransferPriority::HIGH, curl::TransferPriority::BULK));
+    }
+}
+
+TEST(BandwidthLimiter, AggregateUploadRate)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = (connectionData->postData.size() == transferSize) ? 200 : 400;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string postData(transferSize, 'x');
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setBandwidthLimiter(std::make_shared<curl::BandwidthLimiter>(rateBytesPerSecond, 0));
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < 2; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://localhost:" + std::to_string(port) + "/post-url");
+        transfer->setPostData(postData.data(), postData.size());
+        transfers.push_back(transfer);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    curlMultiAsync.performTransfers(transfers);
+    curlMultiAsync.waitForCompletion();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for(const auto &transfer : transfers)
+    {
+        EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfer->responseCode(), 200);
+    }
+
+    double rate = 2 * transferSize / elapsed.count();
+    EXPECT_NEAR(rate, rateBytesPerSecond, rateBytesPerSecond * 0.05) << fmt::format("elapsed {:.3f} s", elapsed.count());
+}
+
+TEST(BandwidthLimiter, ResumeKeepsTheLimit)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = (connectionData->postData.size() == transferSize) ? 200 : 400;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string postData(transferSize, 'x');
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setBandwidthLimiter(std::make_shared<curl::BandwidthLimiter>(rateBytesPerSecond, 0));
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://localhost:" + std::to_string(port) + "/post-url");
+    transfer->setPostData(postData.data(), postData.size());
+
+    // Resume requests of a producer must not continue a transfer, which the limiter paused
+    std::atomic<bool> finished{false};
+    std::thread producer([&]()
+    {
+        while(!finished)
+        {
+            curlMultiAsync.resumeTransfer(transfer);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    finished = true;
+    producer.join();
+
+    EXPECT_EQ(transfer->responseCode(), 200);
+
+    double rate = transferSize / elapsed.count();
+    EXPECT_NEAR(rate, rateBytesPerSecond, rateBytesPerSecond * 0.05) << fmt::format("elapsed {:.3f} s", elapsed.count());
+}
+
+TEST(BandwidthLimiter, PerTransferCap)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = std::string(2 * transferSize, 'x');
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+    transfer->setMaxDownloadSpeed_BytesPerSecond(rateBytesPerSecond);
+
+    auto start = std::chrono::steady_clock::now();
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+    EXPECT_EQ(transfer->responseCode(), 200);
+
+    // libcurl is less exact than the token buckets: it lets a burst of up to a second pass before it throttles
+    EXPECT_GT(elapsed.count(), 0.5);
+}
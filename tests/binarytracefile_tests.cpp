@@ -0,0 +1,171 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/binarytracefile.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/traceconfiguration.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+std::string decodeToText(const std::string &filename, std::vector<curl::BinaryTraceRecord> *records = nullptr)
+{
+    curl::BinaryTraceReader reader(logger);
+    reader.open(filename);
+
+    std::ostringstream text;
+    curl::BinaryTraceRecord record;
+    while(reader.next(record))
+    {
+        reader.writeText(text, record);
+        if(records)
+            records->push_back(record);
+    }
+
+    return text.str();
+}
+
+size_t fileSize(const std::string &filename)
+{
+    struct stat fileStatus;
+    return (stat(filename.c_str(), &fileStatus) == 0) ? fileStatus.st_size : 0;
+}
+
+// Traces a header and a payload of 1 MiB in 16 KiB pieces, like libcurl does
+void writeTrace(const std::string &filename, bool enableCompression, std::string &expectedText)
+{
+    std::string header = "GET /binary-trace HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::vector<char> piece(16 * 1024);
+    for(size_t i = 0; i < piece.size(); i++)
+        piece[i] = static_cast<char>(i % 64);
+
+    curl::BinaryTraceFile traceFile(logger);
+    traceFile.setFilename(filename);
+    traceFile.setTransferId(4711);
+    traceFile.enableCompression(enableCompression);
+    traceFile.initialize();
+
+    traceFile.traceMessage("### Timestamp: now ###\n");
+    traceFile.traceCurlDebugInfo(nullptr, CURLINFO_HEADER_OUT, header.data(), header.size());
+    traceFile.traceCurlDebugInfo(nullptr, CURLINFO_SSL_DATA_IN, piece.data(), 100); // hidden
+    for(int i = 0; i < 64; i++)
+        traceFile.traceCurlDebugInfo(nullptr, CURLINFO_DATA_IN, piece.data(), piece.size());
+    traceFile.finalize();
+
+    // The times of the records are only known after reading them
+    std::vector<curl::BinaryTraceRecord> records;
+    decodeToText(filename, &records);
+    ASSERT_EQ(records.size(), 67);
+
+    std::ostringstream text;
+    text << "### Timestamp: now ###\n";
+    curl::TraceFile::writeCurlDebugInfo(text, CURLINFO_HEADER_OUT, header.data(), header.size(),
+                                        std::chrono::duration_cast<std::chrono::milliseconds>(records[1].time), curl::TracePayload::DATA, 0);
+    curl::TraceFile::writeCurlDebugInfo(text, CURLINFO_SSL_DATA_IN, piece.data(), 100,
+                                        std::chrono::duration_cast<std::chrono::milliseconds>(records[2].time), curl::TracePayload::HIDDEN, 0);
+    for(int i = 0; i < 64; i++)
+        curl::TraceFile::writeCurlDebugInfo(text, CURLINFO_DATA_IN, piece.data(), piece.size(),
+                                            std::chrono::duration_cast<std::chrono::milliseconds>(records[3 + i].time), curl::TracePayload::DATA, 0);
+    expectedText = text.str();
+
+    for(const auto &record : records)
+        EXPECT_EQ(record.transferId, 4711);
+    EXPECT_EQ(records[2].size, 100);
+    EXPECT_TRUE(records[2].data.empty());
+}
+
+}
+
+TEST(BinaryTraceFile, RoundTrip)
+{
+    std::string filename = "/tmp/libcurl-wrapper-binary-trace-test.ctb";
+    std::string expectedText;
+    writeTrace(filename, false, expectedText);
+
+    // The same text as TraceFile, but the file holds the raw bytes plus 28 bytes per record
+    EXPECT_EQ(decodeToText(filename), expectedText);
+    EXPECT_LT(fileSize(filename), 64 * 16 * 1024 * 1.01);
+    EXPECT_GT(expectedText.size(), 64 * 16 * 1024 * 2.5);
+
+    unlink(filename.c_str());
+}
+
+TEST(BinaryTraceFile, Compression)
+{
+    if(!curl::BinaryTraceFile::compressionSupported())
+        GTEST_SKIP() << "libcurl-wrapper was built without zstd";
+
+    std::string filename = "/tmp/libcurl-wrapper-binary-trace-test.ctb";
+    std::string expectedText;
+    writeTrace(filename, true, expectedText);
+
+    EXPECT_EQ(decodeToText(filename), expectedText);
+    EXPECT_LT(fileSize(filename), 64 * 16 * 1024 / 10);
+
+    unlink(filename.c_str());
+}
+
+TEST(BinaryTraceFile, CorruptFile)
+{
+    std::string filename = "/tmp/libcurl-wrapper-binary-trace-test.ctb";
+    std::string expectedText;
+    writeTrace(filename, false, expectedText);
+
+    ASSERT_EQ(truncate(filename.c_str(), fileSize(filename) - 10), 0);
+    EXPECT_THROW(decodeToText(filename), std::runtime_error);
+
+    std::ofstream(filename, std::ios::out | std::ios::trunc) << "### INFO: text trace ###";
+    EXPECT_THROW(decodeToText(filename), std::runtime_error);
+
+    unlink(filename.c_str());
+}
+
+TEST(BinaryTraceFile, TraceTransfer)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setTraceFormat(curl::TraceFormat::BINARY);
+    traceConfiguration->setFilenamePrefix("libcurl-wrapper-binary-trace-test");
+    traceConfiguration->setRotationPoolSize(1);
+    traceConfiguration->enableTracing(1);
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/binary-trace");
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    EXPECT_EQ(transfer->responseCode(), 200);
+
+    std::string filename = "/tmp/libcurl-wrapper-binary-trace-test_0.ctb";
+    std::vector<curl::BinaryTraceRecord> records;
+    std::string text = decodeToText(filename, &records);
+    unlink(filename.c_str());
+
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ(records.front().transferId, transfer->transferId());
+    EXPECT_THAT(text, testing::StartsWith("### Timestamp: "));
+    EXPECT_THAT(text, testing::HasSubstr("GET /binary-trace HTTP/1.1"));
+    EXPECT_THAT(text, testing::HasSubstr("### DATA_IN: 8 bytes, time "));
+    EXPECT_THAT(text, testing::EndsWith("### Response Code: 200 ###\n"));
+}
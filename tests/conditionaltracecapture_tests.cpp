@@ -0,0 +1,239 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/conditionaltracecapture.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/hedgingpolicy.hpp"
+#include "libcurl-wrapper/traceconfiguration.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+std::string readFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+bool fileExists(const std::string &filename)
+{
+    return access(filename.c_str(), F_OK) == 0;
+}
+
+}
+
+TEST(ConditionalTraceCapture, Policy)
+{
+    curl::TraceCapturePolicy policy;
+    policy.responseCodes = {429};
+
+    EXPECT_TRUE(policy.shouldCapture(curl::AsyncResult::TIMEOUT, CURLE_ABORTED_BY_CALLBACK, -1));
+    EXPECT_TRUE(policy.shouldCapture(curl::AsyncResult::CANCELED, CURLE_OK, -1));
+    EXPECT_TRUE(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_COULDNT_CONNECT, -1));
+    EXPECT_TRUE(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_OK, 429));
+    EXPECT_FALSE(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_OK, 200));
+    EXPECT_FALSE(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_OK, 503));
+
+    policy.captureServerErrors = true;
+    policy.captureTimeouts = false;
+    EXPECT_TRUE(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_OK, 503));
+    EXPECT_FALSE(policy.shouldCapture(curl::AsyncResult::TIMEOUT, CURLE_ABORTED_BY_CALLBACK, -1));
+
+    // Sampling: roughly every tenth successful transfer
+    policy.sampleRate = 0.1;
+    int sampled = 0;
+    for(int i = 0; i < 10000; i++)
+    {
+        if(policy.shouldCapture(curl::AsyncResult::CURL_DONE, CURLE_OK, 200))
+            sampled++;
+    }
+
+    EXPECT_GT(sampled, 800);
+    EXPECT_LT(sampled, 1200);
+}
+
+TEST(ConditionalTraceCapture, WritesOnlySelectedTransfers)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([](httpmock::ConnectionData *connectionData)
+    {
+        if(connectionData->url == "/slow")
+            std::this_thread::sleep_for(std::chrono::milliseconds(3000)); // the progress timeout counts whole seconds
+
+        connectionData->responseCode = (connectionData->url == "/unavailable") ? 503 : 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::TraceCapturePolicy policy;
+    policy.captureServerErrors = true;
+
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setFilenamePrefix("libcurl-wrapper-capture-test");
+    traceConfiguration->setRotationPoolSize(4);
+    traceConfiguration->enableConditionalCapture(policy);
+    traceConfiguration->enableTracing();
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+    // One after another, so the traces are written in this order
+    auto performTransfer = [&](const std::string &path, int progressTimeout_s = 0)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + path);
+        if(progressTimeout_s > 0)
+            transfer->setProgressTimeout_s(progressTimeout_s);
+
+        curlMultiAsync.performTransfer(transfer);
+        curlMultiAsync.waitForCompletion();
+        return transfer;
+    };
+
+    for(int i = 0; i < 5; i++)
+        EXPECT_EQ(performTransfer("/ok")->responseCode(), 200);
+
+    EXPECT_EQ(performTransfer("/unavailable")->responseCode(), 503);
+    EXPECT_EQ(performTransfer("/slow", 1)->asyncResult(), curl::AsyncResult::TIMEOUT);
+    EXPECT_EQ(performTransfer("/ok")->responseCode(), 200);
+
+    std::string unavailableTrace = readFile("/tmp/libcurl-wrapper-capture-test_0.ctf");
+    std::string timeoutTrace = readFile("/tmp/libcurl-wrapper-capture-test_1.ctf");
+    bool thirdTrace = fileExists("/tmp/libcurl-wrapper-capture-test_2.ctf");
+
+    for(int i = 0; i < 4; i++)
+        unlink(fmt::format("/tmp/libcurl-wrapper-capture-test_{}.ctf", i).c_str());
+
+    // The same text as TraceFile, including the times
+    EXPECT_THAT(unavailableTrace, testing::StartsWith("### Timestamp: "));
+    EXPECT_THAT(unavailableTrace, testing::HasSubstr("GET /unavailable HTTP/1.1"));
+    EXPECT_THAT(unavailableTrace, testing::HasSubstr("### DATA_IN: 8 bytes, time "));
+    EXPECT_THAT(unavailableTrace, testing::EndsWith("### Response Code: 503 ###\n"));
+
+    EXPECT_THAT(timeoutTrace, testing::HasSubstr("GET /slow HTTP/1.1"));
+    EXPECT_FALSE(thirdTrace);
+}
+
+TEST(ConditionalTraceCapture, BufferLimit)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 500;
+        connectionData->responseBody = std::string(1024 * 1024, 'x');
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::TraceCapturePolicy policy;
+    policy.captureServerErrors = true;
+    policy.maxBufferSize = 64 * 1024;
+
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setTraceFormat(curl::TraceFormat::BINARY);
+    traceConfiguration->setFilenamePrefix("libcurl-wrapper-capture-test");
+    traceConfiguration->setRotationPoolSize(1);
+    traceConfiguration->enableConditionalCapture(policy);
+    traceConfiguration->enableTracing(1);
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/large");
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    EXPECT_EQ(transfer->responseCode(), 500);
+
+    std::string filename = "/tmp/libcurl-wrapper-capture-test_0.ctb";
+    curl::BinaryTraceReader reader(logger);
+    reader.open(filename);
+
+    size_t storedBytes = 0;
+    std::vector<curl::BinaryTraceRecord> records;
+    curl::BinaryTraceRecord record;
+    while(reader.next(record))
+    {
+        storedBytes += curl::BinaryTraceFile::recordHeaderSize + record.data.size();
+        records.push_back(record);
+    }
+    unlink(filename.c_str());
+
+    // The records up to the limit, then a note about the rest
+    ASSERT_GE(records.size(), 2);
+    EXPECT_EQ(records.front().transferId, transfer->transferId());
+    EXPECT_LT(storedBytes, 64 * 1024 + 128);
+    EXPECT_THAT(std::string(records.back().data.begin(), records.back().data.end()),
+                testing::MatchesRegex("### [0-9]+ trace entries dropped, the capture buffer is full ###\n"));
+}
+
+TEST(ConditionalTraceCapture, IgnoresHedgeCopies)
+{
+    constexpr int warmupRequests = 20;
+    std::atomic<int> requests{0};
+
+    // The original answers before its hedged copy, which is canceled then
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        int request = ++requests;
+        if(request == warmupRequests + 1)
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        else if(request > warmupRequests + 1)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setFilenamePrefix("libcurl-wrapper-capture-test");
+    traceConfiguration->setRotationPoolSize(4);
+    traceConfiguration->enableConditionalCapture(curl::TraceCapturePolicy());
+    traceConfiguration->enableTracing();
+
+    auto hedgingPolicy = std::make_shared<curl::HedgingPolicy>();
+    hedgingPolicy->setMinSamples(warmupRequests);
+    hedgingPolicy->setMinDelay(std::chrono::milliseconds(20));
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+    curlMultiAsync.setHedgingPolicy(hedgingPolicy);
+
+    for(int i = 0; i < warmupRequests + 1; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+        curlMultiAsync.performTransfer(transfer);
+        curlMultiAsync.waitForCompletion();
+        EXPECT_EQ(transfer->responseCode(), 200);
+    }
+
+    bool trace = fileExists("/tmp/libcurl-wrapper-capture-test_0.ctf");
+    for(int i = 0; i < 4; i++)
+        unlink(fmt::format("/tmp/libcurl-wrapper-capture-test_{}.ctf", i).c_str());
+
+    // The canceled copy is neither traced nor captured
+    EXPECT_EQ(curlMultiAsync.hedgingStatistics().hedgedTransfers, 1);
+    EXPECT_EQ(curlMultiAsync.hedgingStatistics().hedgeWins, 0);
+    EXPECT_FALSE(trace);
+}
@@ -0,0 +1,49 @@
+#include "libcurl-wrapper/curlhandlepool.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <thread>
+
+extern cu::Logger logger;
+
+TEST(CurlHandlePoolBenchmark, CreateTransfers)
+{
+    const int threadCount = 8;
+    const int transfersPerThread = 20000;
+
+    auto &pool = curl::CurlHandlePool::instance();
+
+    for(size_t maxSize : {0, 64})
+    {
+        pool.setMaxSize(maxSize);
+        auto before = pool.statistics();
+
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for(int i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&]()
+            {
+                for(int j = 0; j < transfersPerThread; j++)
+                {
+                    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+                    transfer->setUrl("http://127.0.0.1/");
+                }
+            });
+        }
+
+        for(auto &thread : threads)
+            thread.join();
+
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - begin;
+        auto after = pool.statistics();
+
+        std::cout << fmt::format("pool size {:2}: {} transfers created in {:.3f} s, {} curl_easy_init(), {} reused, {} curl_easy_cleanup()",
+                                 maxSize, threadCount * transfersPerThread, duration.count(),
+                                 after.easyInits - before.easyInits, after.reuses - before.reuses, after.cleanups - before.cleanups) << std::endl;
+    }
+
+    pool.setMaxSize(0);
+}
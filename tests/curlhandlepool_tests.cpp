@@ -0,0 +1,60 @@
+#include "libcurl-wrapper/curlhandlepool.hpp"
+#include "libcurl-wrapper/curlholder.hpp"
+
+#include <gmock/gmock.h>
+
+TEST(CurlHandlePool, DisabledByDefault)
+{
+    auto &pool = curl::CurlHandlePool::instance();
+    EXPECT_EQ(pool.maxSize(), 0);
+
+    auto before = pool.statistics();
+    {
+        curl::CurlHolder holder;
+        EXPECT_NE(holder.handle, nullptr);
+    }
+    auto after = pool.statistics();
+
+    EXPECT_EQ(after.easyInits, before.easyInits + 1);
+    EXPECT_EQ(after.cleanups,  before.cleanups + 1);
+    EXPECT_EQ(after.pooledHandles, 0);
+}
+
+TEST(CurlHandlePool, ReuseHandles)
+{
+    auto &pool = curl::CurlHandlePool::instance();
+    pool.setMaxSize(2);
+
+    auto before = pool.statistics();
+    CURL *firstHandle;
+    {
+        curl::CurlHolder holder;
+        firstHandle = holder.handle;
+        curl_easy_setopt(holder.handle, CURLOPT_PRIVATE, &firstHandle);
+    }
+
+    {
+        curl::CurlHolder holder;
+        EXPECT_EQ(holder.handle, firstHandle);
+
+        void *privateData = nullptr;
+        curl_easy_getinfo(holder.handle, CURLINFO_PRIVATE, &privateData);
+        EXPECT_EQ(privateData, nullptr); // the options of the previous user are gone
+    }
+
+    {
+        // the third handle exceeds the pool size
+        curl::CurlHolder holder1;
+        curl::CurlHolder holder2;
+        curl::CurlHolder holder3;
+    }
+
+    auto after = pool.statistics();
+    EXPECT_EQ(after.easyInits - before.easyInits, 3);
+    EXPECT_EQ(after.reuses - before.reuses, 2);
+    EXPECT_EQ(after.cleanups - before.cleanups, 1);
+    EXPECT_EQ(after.pooledHandles, 2);
+
+    pool.setMaxSize(0);
+    EXPECT_EQ(pool.statistics().pooledHandles, 0);
+}
@@ -66,6 +66,7 @@ TEST(CurlAsyncTransfer, Get)
         connectionData->responseHeader["Content-Type"] = "application/om-scpi-app";
         connectionData->responseBody = response;
         connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // keep the transfer RUNNING until waitForStarted() has seen it
     });
 
     mockServer.start();
@@ -116,6 +117,7 @@ TEST(CurlAsyncTransfer, Post)
         connectionData->responseHeader["Content-Type"] = "application/om-scpi-app";
         connectionData->responseBody = response;
         connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // keep the transfer RUNNING until waitForStarted() has seen it
     });
 
     mockServer.start();
@@ -174,6 +176,7 @@ TEST(CurlAsyncTransfer, PostCopyData)
         connectionData->responseHeader["Content-Type"] = "application/om-scpi-app";
         connectionData->responseBody = response;
         connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // keep the transfer RUNNING until waitForStarted() has seen it
     });
 
     mockServer.start();
@@ -248,6 +251,7 @@ TEST(CurlAsyncTransfer, PostFile)
         connectionData->responseHeader["Content-Type"] = "application/om-scpi-app";
         connectionData->responseBody = response;
         connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // keep the transfer RUNNING until waitForStarted() has seen it
     });
 
     mockServer.start();
@@ -301,6 +305,7 @@ TEST(CurlAsyncTransfer, OutputToFile)
     {
         connectionData->responseBody = response;
         connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // keep the transfer RUNNING until waitForStarted() has seen it
     });
 
     mockServer.start();
@@ -419,3 +424,55 @@ TEST(CurlAsyncTransfer, MaxTransferDuration)
     bool success = mockServer.waitForRequestCompleted(1, 1000);
     EXPECT_TRUE(success);
 }
+
+TEST(CurlAsyncTransfer, TransferTimings)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setMaxRunningTransfers(1); // the second transfer waits for the first one
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::vector<std::shared_ptr<curl::CurlHttpTransfer>> transfers;
+    for(int i = 0; i < 2; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/timings");
+        curlMultiAsync.performTransfer(transfer);
+        transfers.push_back(transfer);
+    }
+
+    curlMultiAsync.waitForCompletion();
+
+    for(const auto &transfer : transfers)
+    {
+        const curl::TransferTimings &timings = transfer->transferTimings();
+        EXPECT_EQ(transfer->responseCode(), 200);
+
+        EXPECT_EQ(timings.appConnect, std::chrono::microseconds(0)); // no TLS
+        EXPECT_LE(timings.nameLookup, timings.preTransfer);
+        EXPECT_LE(timings.connect, timings.preTransfer);
+        EXPECT_LE(timings.preTransfer, timings.startTransfer);
+        EXPECT_LE(timings.startTransfer, timings.total);
+        EXPECT_EQ(timings.redirect, std::chrono::microseconds(0));
+
+        // The server answers after 200 ms: the time to first byte
+        EXPECT_GE(timings.startTransfer, std::chrono::milliseconds(190));
+    }
+
+    // The second transfer reuses the connection of the first one
+    EXPECT_GT(transfers[0]->transferTimings().connect, std::chrono::microseconds(0));
+    EXPECT_LE(transfers[0]->transferTimings().nameLookup, transfers[0]->transferTimings().connect);
+    EXPECT_EQ(transfers[1]->transferTimings().connect, std::chrono::microseconds(0));
+
+    EXPECT_LT(transfers[0]->transferTimings().queueWait, std::chrono::milliseconds(100));
+    EXPECT_GE(transfers[1]->transferTimings().queueWait, std::chrono::milliseconds(190));
+}
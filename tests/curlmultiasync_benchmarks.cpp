@@ -0,0 +1,647 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/curlmultiasyncpool.hpp"
+#include "libcurl-wrapper/curlshare.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "cpp-utils/loggingstdout.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+
+int port = 57567;
+cu::Logger logger;
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static int64_t percentile(std::vector<int64_t> values, double rank)
+{
+    if(values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(rank / 100.0 * (values.size() - 1));
+    return values.at(index);
+}
+
+static std::vector<int64_t> measureEnqueueToCallbackLatencies(curl::CurlMultiAsync &curlMultiAsync, const std::string &requestUrl, int iterations)
+{
+    std::vector<int64_t> latencies_us;
+    latencies_us.reserve(iterations);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    for(int i = 0; i < iterations; i++)
+    {
+        bool done = false;
+        BenchmarkClock::time_point end;
+
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl(requestUrl);
+        transfer->setTransferCallback([&](const curl::CurlAsyncTransfer *)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            end = BenchmarkClock::now();
+            done = true;
+            finished.notify_one();
+        });
+
+        // Measure from an idle stack: this is the case, where the old 100 ms sleep added its latency floor
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        auto begin = BenchmarkClock::now();
+        curlMultiAsync.performTransfer(transfer);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if(!finished.wait_for(lock, std::chrono::seconds(5), [&]{ return done; }))
+        {
+            ADD_FAILURE() << "transfer did not finish within 5 seconds";
+            break;
+        }
+
+        latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+    }
+
+    return latencies_us;
+}
+
+TEST(CurlMultiAsyncBenchmark, EnqueueToCallbackLatency)
+{
+    const int iterations = 500;
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/latency";
+    auto latencies_us = measureEnqueueToCallbackLatencies(curlMultiAsync, requestUrl, iterations);
+
+    auto p50 = percentile(latencies_us, 50);
+    auto p99 = percentile(latencies_us, 99);
+    std::cout << fmt::format("enqueue-to-callback latency over {} transfers: p50 {} us, p99 {} us", iterations, p50, p99) << std::endl;
+
+    EXPECT_LT(p50, 1000);
+}
+
+TEST(CurlMultiAsyncBenchmark, IdleConnectionScaling)
+{
+    // Keep idleTransfers below the file descriptor limit: the mock server runs in this process, so every connection needs two descriptors
+    const int idleTransfers = 400;
+    const int iterations = 200;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        if(connectionData->url == "/idle")
+            std::this_thread::sleep_for(std::chrono::seconds(10)); // long polling request, which is canceled by the benchmark
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    std::string idleUrl   = "http://127.0.0.1:" + std::to_string(port) + "/idle";
+    std::string activeUrl = "http://127.0.0.1:" + std::to_string(port) + "/active";
+
+    for(auto eventLoop : {curl::EventLoop::POLL, curl::EventLoop::SOCKET_ACTION})
+    {
+        curl::CurlMultiAsync curlMultiAsync(logger, eventLoop);
+
+        for(int i = 0; i < idleTransfers; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+            transfer->setUrl(idleUrl);
+            curlMultiAsync.performTransfer(transfer);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500)); // let the idle connections be established
+
+        auto latencies_us = measureEnqueueToCallbackLatencies(curlMultiAsync, activeUrl, iterations);
+
+        std::cout << fmt::format("{} with {} idle transfers: p50 {} us, p99 {} us",
+                                 eventLoop == curl::EventLoop::POLL ? "POLL" : "SOCKET_ACTION", idleTransfers,
+                                 percentile(latencies_us, 50), percentile(latencies_us, 99)) << std::endl;
+
+        curlMultiAsync.cancelAllTransfers();
+        curlMultiAsync.waitForCompletion();
+    }
+}
+
+TEST(CurlMultiAsyncBenchmark, PoolThroughput)
+{
+    const int transfersPerRun = 2000;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = std::string(4096, 'x');
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/throughput";
+
+    for(size_t workers : {1, 2, 4, 8})
+    {
+        curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, workers);
+
+        std::vector<std::shared_ptr<curl::CurlHttpTransfer>> transfers;
+        transfers.reserve(transfersPerRun);
+        for(int i = 0; i < transfersPerRun; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl(requestUrl);
+            transfers.push_back(transfer);
+        }
+
+        auto begin = BenchmarkClock::now();
+        for(auto &transfer : transfers)
+            curlMultiAsyncPool.performTransfer(transfer);
+
+        curlMultiAsyncPool.waitForCompletion();
+        std::chrono::duration<double> duration = BenchmarkClock::now() - begin;
+
+        std::cout << fmt::format("{} workers: {} transfers in {:.3f} s => {:.0f} transfers/s",
+                                 workers, transfersPerRun, duration.count(), transfersPerRun / duration.count()) << std::endl;
+    }
+}
+
+TEST(CurlMultiAsyncBenchmark, CompleteManyTransfers)
+{
+    // file:// transfers complete within the first curl_multi_perform() call, without any network I/O.
+    // So this measures the bookkeeping of CurlMultiAsync: with a linear search in the running transfers, it grows quadratically.
+    const int transferCount = 50000;
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    std::atomic<int> completed{0};
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    transfers.reserve(transferCount);
+    for(int i = 0; i < transferCount; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("file:///dev/null");
+        transfer->setTransferCallback([&](const curl::CurlAsyncTransfer *transfer)
+        {
+            if(transfer->curlResult() == CURLE_OK)
+                completed++;
+        });
+        transfers.push_back(transfer);
+    }
+
+    auto begin = BenchmarkClock::now();
+    for(auto &transfer : transfers)
+        curlMultiAsync.performTransfer(transfer);
+
+    curlMultiAsync.waitForCompletion();
+    std::chrono::duration<double> duration = BenchmarkClock::now() - begin;
+
+    std::cout << fmt::format("completed {} transfers in {:.3f} s", completed.load(), duration.count()) << std::endl;
+    EXPECT_EQ(completed, transferCount);
+}
+
+TEST(CurlMultiAsyncBenchmark, SubmissionContention)
+{
+    // 16 producers submit file:// transfers, whose write callbacks keep the multi thread busy inside curl_multi_perform().
+    // performTransfer() must not wait for that work, so its latency should stay in the microsecond range.
+    const int producerCount = 16;
+    const int transfersPerProducer = 500;
+
+    char filename[] = "/tmp/libcurl-wrapper-benchmarkXXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_NE(fd, -1);
+    close(fd);
+    std::ofstream(filename, std::ofstream::binary) << std::string(256 * 1024, 'x');
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    std::vector<std::vector<int64_t>> submitLatencies_ns(producerCount);
+    std::vector<std::thread> producers;
+
+    auto begin = BenchmarkClock::now();
+    for(int producer = 0; producer < producerCount; producer++)
+    {
+        producers.emplace_back([&, producer]()
+        {
+            auto &latencies = submitLatencies_ns.at(producer);
+            latencies.reserve(transfersPerProducer);
+
+            for(int i = 0; i < transfersPerProducer; i++)
+            {
+                auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+                transfer->setUrl(std::string("file://") + filename);
+
+                auto submitBegin = BenchmarkClock::now();
+                curlMultiAsync.performTransfer(transfer);
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - submitBegin).count());
+            }
+        });
+    }
+
+    for(auto &producer : producers)
+        producer.join();
+
+    curlMultiAsync.waitForCompletion();
+    std::chrono::duration<double> duration = BenchmarkClock::now() - begin;
+    std::remove(filename);
+
+    std::vector<int64_t> allLatencies_ns;
+    for(const auto &latencies : submitLatencies_ns)
+        allLatencies_ns.insert(allLatencies_ns.end(), latencies.begin(), latencies.end());
+
+    std::cout << fmt::format("{} producers, {} transfers in {:.3f} s: performTransfer() p50 {} ns, p99 {} ns, max {} ns",
+                             producerCount, allLatencies_ns.size(), duration.count(),
+                             percentile(allLatencies_ns, 50), percentile(allLatencies_ns, 99), percentile(allLatencies_ns, 100)) << std::endl;
+}
+
+TEST(CurlMultiAsyncBenchmark, BatchSubmission)
+{
+    const int batchSize = 500;
+    const int rounds = 20;
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    for(bool batched : {false, true})
+    {
+        std::chrono::duration<double> submitDuration{0};
+        std::chrono::duration<double> totalDuration{0};
+
+        for(int round = 0; round < rounds; round++)
+        {
+            std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+            transfers.reserve(batchSize);
+            for(int i = 0; i < batchSize; i++)
+            {
+                auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+                transfer->setUrl("file:///dev/null");
+                transfers.push_back(transfer);
+            }
+
+            auto begin = BenchmarkClock::now();
+            if(batched)
+                curlMultiAsync.performTransfers(transfers);
+            else
+            {
+                for(auto &transfer : transfers)
+                    curlMultiAsync.performTransfer(transfer);
+            }
+            submitDuration += BenchmarkClock::now() - begin;
+
+            curlMultiAsync.waitForCompletion();
+            totalDuration += BenchmarkClock::now() - begin;
+        }
+
+        std::cout << fmt::format("{}: {} x {} transfers, submit {:.1f} us per batch, completed {:.1f} ms per batch",
+                                 batched ? "performTransfers()" : "performTransfer() ", rounds, batchSize,
+                                 submitDuration.count() * 1e6 / rounds, totalDuration.count() * 1e3 / rounds) << std::endl;
+    }
+}
+
+TEST(CurlMultiAsyncBenchmark, SharedCaches)
+{
+    // Sequential transfers are spread round robin over four stacks, so without the share, each stack needs its own connection.
+    // Set LIBCURL_WRAPPER_BENCHMARK_URL to a local TLS server (e.g. "openssl s_server -www") to see the TLS handshake savings.
+    const int iterations = 200;
+    const int stackCount = 4;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://localhost:" + std::to_string(port) + "/shared";
+    if(const char *url = std::getenv("LIBCURL_WRAPPER_BENCHMARK_URL"))
+        requestUrl = url;
+
+    for(bool shared : {false, true})
+    {
+        // Without sharing, we still attach a CurlShare, but only to collect the statistics
+        // The stacks take turns (one transfer at a time), so they may share connections
+        auto share = shared ? std::make_shared<curl::CurlShare>(logger, true, true, true) : std::make_shared<curl::CurlShare>(logger, false, false, false, false);
+
+        std::vector<std::unique_ptr<curl::CurlMultiAsync>> stacks;
+        for(int i = 0; i < stackCount; i++)
+        {
+            stacks.emplace_back(std::make_unique<curl::CurlMultiAsync>(logger));
+            stacks.back()->setShare(share);
+        }
+
+        std::vector<int64_t> latencies_us;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        for(int i = 0; i < iterations; i++)
+        {
+            bool done = false;
+
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl(requestUrl);
+            transfer->setVerifySslCertificates(false);
+            transfer->setTransferCallback([&](const curl::CurlAsyncTransfer *)
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+                finished.notify_one();
+            });
+
+            auto begin = BenchmarkClock::now();
+            stacks.at(i % stackCount)->performTransfer(transfer);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            ASSERT_TRUE(finished.wait_for(lock, std::chrono::seconds(5), [&]{ return done; }));
+            latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(BenchmarkClock::now() - begin).count());
+        }
+
+        auto statistics = share->statistics();
+        std::cout << fmt::format("{}: {} new connections, {} reused, {} TLS handshakes, p50 {} us",
+                                 shared ? "shared    " : "not shared", statistics.newConnections, statistics.reusedConnections,
+                                 statistics.tlsHandshakes, percentile(latencies_us, 50)) << std::endl;
+    }
+}
+
+// Scatter/gather of 100 requests: waiting with waitForCompletion() (polls every 100 ms) versus futures
+TEST(CurlMultiAsyncBenchmark, ScatterGather)
+{
+    const int requests = 100;
+    const int rounds = 10;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/get-url";
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < requests; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl(requestUrl);
+        transfers.push_back(transfer);
+    }
+
+    std::vector<int64_t> pollingDurations_us;
+    std::vector<int64_t> futureDurations_us;
+    for(int round = 0; round < rounds; round++)
+    {
+        auto begin = BenchmarkClock::now();
+        curlMultiAsync.performTransfers(transfers);
+        curlMultiAsync.waitForCompletion();
+        pollingDurations_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(BenchmarkClock::now() - begin).count());
+
+        begin = BenchmarkClock::now();
+        std::vector<std::future<curl::AsyncResult>> results;
+        for(const auto &transfer : transfers)
+            results.push_back(curlMultiAsync.performTransferAsync(transfer));
+        for(auto &result : results)
+            EXPECT_EQ(result.get(), curl::AsyncResult::CURL_DONE);
+        futureDurations_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(BenchmarkClock::now() - begin).count());
+    }
+
+    std::cout << fmt::format("{} requests: waitForCompletion() p50 {} us, futures p50 {} us",
+                             requests, percentile(pollingDurations_us, 50), percentile(futureDurations_us, 50)) << std::endl;
+}
+
+// A slow callback (20 ms) on every transfer: inline it delays the I/O of all other transfers, queued it doesn't
+TEST(CurlMultiAsyncBenchmark, SlowCallback)
+{
+    const int transferCount = 100;
+    const int drainThreadCount = 8;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/get-url";
+
+    for(auto completionMode : {curl::CompletionMode::INLINE, curl::CompletionMode::QUEUED})
+    {
+        curl::CurlMultiAsync curlMultiAsync(logger, curl::EventLoop::POLL, completionMode);
+
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        for(int i = 0; i < transferCount; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl(requestUrl);
+            transfer->setTransferCallback([](curl::CurlAsyncTransfer *)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            });
+            transfers.push_back(transfer);
+        }
+
+        // I/O is done, as soon as every transfer has left the multi stack
+        std::atomic<int> finishedIo{0};
+        auto begin = BenchmarkClock::now();
+        BenchmarkClock::time_point ioDone;
+
+        std::vector<std::thread> drainThreads;
+        std::atomic<bool> draining{true};
+        if(completionMode == curl::CompletionMode::QUEUED)
+        {
+            for(int i = 0; i < drainThreadCount; i++)
+            {
+                drainThreads.emplace_back([&]()
+                {
+                    while(draining)
+                    {
+                        struct pollfd pfd{curlMultiAsync.completionFd(), POLLIN, 0};
+                        if(poll(&pfd, 1, 10) == 1)
+                            curlMultiAsync.drainCompletions(1);
+                    }
+                });
+            }
+        }
+
+        curlMultiAsync.performTransfers(transfers);
+        while(finishedIo < transferCount)
+        {
+            finishedIo = 0;
+            for(const auto &transfer : transfers)
+                finishedIo += (transfer->asyncResult() == curl::AsyncResult::CURL_DONE);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ioDone = BenchmarkClock::now();
+
+        curlMultiAsync.waitForCompletion();
+        auto allDone = BenchmarkClock::now();
+
+        draining = false;
+        for(auto &thread : drainThreads)
+            thread.join();
+
+        std::cout << fmt::format("{}: {} transfers, I/O finished after {} ms, all callbacks after {} ms",
+                                 (completionMode == curl::CompletionMode::INLINE) ? "inline" : "queued, 8 drain threads", transferCount,
+                                 std::chrono::duration_cast<std::chrono::milliseconds>(ioDone - begin).count(),
+                                 std::chrono::duration_cast<std::chrono::milliseconds>(allDone - begin).count()) << std::endl;
+    }
+}
+
+// Control requests behind a backlog of bulk transfers: with priorities they skip the queue
+TEST(CurlMultiAsyncBenchmark, PriorityUnderBulkLoad)
+{
+    const int bulkTransferCount = 40;
+    const int controlTransferCount = 10;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        if(connectionData->url == "/bulk")
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    for(auto controlPriority : {curl::TransferPriority::BULK, curl::TransferPriority::HIGH})
+    {
+        curl::CurlMultiAsync curlMultiAsync(logger);
+        curlMultiAsync.setMaxRunningTransfers(4);
+
+        std::mutex mutex;
+        std::vector<int64_t> controlLatencies_us;
+
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        for(int i = 0; i < bulkTransferCount + controlTransferCount; i++)
+        {
+            bool control = (i >= bulkTransferCount);
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + (control ? "/control" : "/bulk"));
+            transfer->setPriority(control ? controlPriority : curl::TransferPriority::BULK);
+            if(control)
+            {
+                transfer->setTransferCallback([&](curl::CurlAsyncTransfer *transfer)
+                {
+                    const std::lock_guard<std::mutex> lock(mutex);
+                    controlLatencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(BenchmarkClock::now() - transfer->timepointQueued()).count());
+                });
+            }
+            transfers.push_back(transfer);
+        }
+
+        curlMultiAsync.performTransfers(transfers);
+        curlMultiAsync.waitForCompletion();
+
+        std::cout << fmt::format("{} control requests behind {} bulk transfers, submitted as {}: p50 {} us, max {} us",
+                                 controlTransferCount, bulkTransferCount, (controlPriority == curl::TransferPriority::HIGH) ? "HIGH" : "BULK",
+                                 percentile(controlLatencies_us, 50), percentile(controlLatencies_us, 100)) << std::endl;
+    }
+}
+
+// Connections and throughput of parallel requests to one host.
+// Set LIBCURL_WRAPPER_H2C_URL to a file on a local h2c server to compare HTTP/2 multiplexing, e.g. with nghttp2:
+//   nghttpd --no-tls -d /tmp 8080   and   LIBCURL_WRAPPER_H2C_URL=http://localhost:8080/file
+TEST(CurlMultiAsyncBenchmark, ConnectionPolicy)
+{
+    const int transferCount = 500;
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = std::string(1024, 'x');
+    });
+
+    mockServer.start();
+    ASSERT_TRUE(mockServer.isRunning());
+
+    struct Scenario
+    {
+        std::string name;
+        std::string url;
+        curl::HttpVersion httpVersion;
+        curl::ConnectionPolicy connectionPolicy;
+    };
+
+    std::string mockUrl = "http://localhost:" + std::to_string(port) + "/connections";
+    std::vector<Scenario> scenarios;
+    scenarios.push_back({"HTTP/1.1, unlimited          ", mockUrl, curl::HttpVersion::HTTP_1_1, {}});
+    scenarios.push_back({"HTTP/1.1, 8 per host         ", mockUrl, curl::HttpVersion::HTTP_1_1, {true, false, 8, 0, 0}});
+
+    if(const char *h2cUrl = std::getenv("LIBCURL_WRAPPER_H2C_URL"))
+    {
+        scenarios.push_back({"h2c, not multiplexed, 8/host ", h2cUrl, curl::HttpVersion::HTTP_2_PRIOR_KNOWLEDGE, {false, false, 8, 0, 0}});
+        scenarios.push_back({"h2c, multiplexed             ", h2cUrl, curl::HttpVersion::HTTP_2_PRIOR_KNOWLEDGE, {true, false, 0, 0, 0}});
+        scenarios.push_back({"h2c, multiplexed + pipewait  ", h2cUrl, curl::HttpVersion::HTTP_2_PRIOR_KNOWLEDGE, {true, true, 0, 0, 0}});
+    }
+    else
+        std::cout << "LIBCURL_WRAPPER_H2C_URL is not set: skipping the HTTP/2 scenarios" << std::endl;
+
+    for(const auto &scenario : scenarios)
+    {
+        curl::CurlMultiAsync curlMultiAsync(logger);
+        curlMultiAsync.setConnectionPolicy(scenario.connectionPolicy);
+
+        std::atomic<long> newConnections{0};
+        std::atomic<int> failedTransfers{0};
+
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        for(int i = 0; i < transferCount; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+            transfer->setUrl(scenario.url);
+            transfer->setHttpVersion(scenario.httpVersion);
+            transfer->setTransferCallback([&](curl::CurlAsyncTransfer *transfer)
+            {
+                long connects = 0;
+                curl_easy_getinfo(transfer->curl().handle, CURLINFO_NUM_CONNECTS, &connects);
+                newConnections += connects;
+
+                if(transfer->responseCode() != 200)
+                    failedTransfers++;
+            });
+            transfers.push_back(transfer);
+        }
+
+        auto begin = BenchmarkClock::now();
+        curlMultiAsync.performTransfers(transfers);
+        curlMultiAsync.waitForCompletion();
+        std::chrono::duration<double> elapsed = BenchmarkClock::now() - begin;
+
+        // Not asserted: libcurl 7.88 fails HTTP/2 transfers that wait for a stream on a reused connection (CURLE_HTTP2)
+        std::cout << fmt::format("{}: {:4} connections, {:6.0f} requests/s, {} failed", scenario.name, newConnections.load(),
+                                 transferCount / elapsed.count(), failedTransfers.load()) << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    logger = std::make_shared<cu::NullLogger>();
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    int returnValue = RUN_ALL_TESTS();
+
+    curl_global_cleanup();
+    return returnValue;
+}
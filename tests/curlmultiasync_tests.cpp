@@ -1,11 +1,16 @@
 #include "httpmockserver/httpmockserver.hpp"
 #include "libcurl-wrapper/curlmultiasync.hpp"
 #include "libcurl-wrapper/curlasynctransfer.hpp"
+#include "libcurl-wrapper/transferawaitable.hpp"
 #include "cpp-utils/loggingstdout.hpp"
 
 #include <fmt/core.h>
 #include <gmock/gmock.h>
 
+#include <condition_variable>
+#include <deque>
+#include <poll.h>
+
 int port = 57567;
 cu::Logger logger;
 
@@ -96,6 +101,491 @@ TEST(CurlMultiAsync, cancelTransfer)
     EXPECT_TRUE(success);
 }
 
+TEST(CurlMultiAsync, SocketActionTransfer)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger, curl::EventLoop::SOCKET_ACTION);
+
+    std::string url = "/get-url";
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "<html><body>HttpMockServer</body></html>";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + url;
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < 10; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl(requestUrl);
+        curlMultiAsync.performTransfer(transfer);
+        transfers.push_back(transfer);
+    }
+
+    EXPECT_TRUE(curlMultiAsync.waitForStarted(1000));
+    curlMultiAsync.waitForCompletion();
+
+    for(const auto &transfer : transfers)
+    {
+        EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfer->curlResult(), CURLE_OK) << curl_easy_strerror(transfer->curlResult());
+        EXPECT_EQ(transfer->responseCode(), 200);
+    }
+
+    bool success = mockServer.waitForRequestCompleted(10, 1000);
+    EXPECT_TRUE(success);
+}
+
+TEST(CurlMultiAsync, SocketActionCancelTransfer)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger, curl::EventLoop::SOCKET_ACTION);
+
+    std::string url = "/get-url";
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + url;
+    transfer->setUrl(requestUrl);
+
+    curlMultiAsync.performTransfer(transfer);
+    EXPECT_TRUE(curlMultiAsync.waitForStarted(1000));
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::RUNNING);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    curlMultiAsync.cancelTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CANCELED);
+
+    bool success = mockServer.waitForRequestCompleted(1, 1000);
+    EXPECT_TRUE(success);
+}
+
+TEST(CurlMultiAsync, BatchTransfers)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    std::string url = "/get-url";
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        if(connectionData->url == "/slow-url")
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> slowTransfers;
+    for(int i = 0; i < 20; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + (i % 2 ? "/get-url" : "/slow-url"));
+        transfers.push_back(transfer);
+
+        if(i % 2 == 0)
+            slowTransfers.push_back(transfer);
+    }
+
+    curlMultiAsync.performTransfers(transfers);
+    EXPECT_TRUE(curlMultiAsync.waitForStarted(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    curlMultiAsync.cancelTransfers(slowTransfers);
+    curlMultiAsync.waitForCompletion();
+
+    for(size_t i = 0; i < transfers.size(); i++)
+    {
+        if(i % 2)
+        {
+            EXPECT_EQ(transfers.at(i)->asyncResult(), curl::AsyncResult::CURL_DONE);
+            EXPECT_EQ(transfers.at(i)->responseCode(), 200);
+        }
+        else
+            EXPECT_EQ(transfers.at(i)->asyncResult(), curl::AsyncResult::CANCELED);
+    }
+
+    bool success = mockServer.waitForRequestCompleted(20, 1000);
+    EXPECT_TRUE(success);
+}
+
+TEST(CurlMultiAsync, FutureScatterGather)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    std::vector<std::future<curl::AsyncResult>> results;
+    for(int i = 0; i < 20; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+        transfers.push_back(transfer);
+        results.push_back(curlMultiAsync.performTransferAsync(transfer));
+    }
+
+    // a pending transfer can't be submitted a second time
+    EXPECT_THROW(curlMultiAsync.performTransferAsync(transfers.front()), std::runtime_error);
+
+    for(size_t i = 0; i < transfers.size(); i++)
+    {
+        EXPECT_EQ(results.at(i).get(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfers.at(i)->responseCode(), 200);
+    }
+
+    // the transfer can be reused as soon as its future is ready
+    EXPECT_EQ(curlMultiAsync.performTransferAsync(transfers.front()).get(), curl::AsyncResult::CURL_DONE);
+}
+
+TEST(CurlMultiAsync, WaitForCompletions)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        if(connectionData->url == "/slow-url")
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    uint64_t completed = curlMultiAsync.completedTransfers();
+
+    std::atomic<int> callbacks{0};
+    std::chrono::steady_clock::time_point lastCallback;
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < 4; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + (i == 0 ? "/slow-url" : "/get-url"));
+        transfer->setTransferCallback([&](curl::CurlAsyncTransfer *)
+        {
+            lastCallback = std::chrono::steady_clock::now();
+            callbacks++;
+        });
+        transfers.push_back(transfer);
+    }
+
+    curlMultiAsync.performTransfers(transfers);
+    EXPECT_TRUE(curlMultiAsync.waitForStarted(1000));
+
+    // the three fast ones
+    EXPECT_TRUE(curlMultiAsync.waitForCompletedTransfers(completed + 3, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+    EXPECT_GE(callbacks, 3);
+
+    // the slow one is still running
+    EXPECT_FALSE(curlMultiAsync.waitForCompletion(std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+
+    EXPECT_TRUE(curlMultiAsync.waitForAnyCompletion(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+    curlMultiAsync.waitForCompletion();
+    auto returned = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(callbacks, 4);
+    EXPECT_EQ(curlMultiAsync.completedTransfers(), completed + 4);
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(returned - lastCallback).count(), 50); // no polling interval
+
+    // nothing left to wait for
+    EXPECT_FALSE(curlMultiAsync.waitForAnyCompletion(std::chrono::steady_clock::now() + std::chrono::milliseconds(10)));
+}
+
+TEST(CurlMultiAsync, PriorityAdmission)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setMaxRunningTransfers(1);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::mutex mutex;
+    std::vector<std::string> finished;
+    auto createTransfer = [&](const std::string &name, curl::TransferPriority priority)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/" + name);
+        transfer->setPriority(priority);
+        transfer->setTransferCallback([&mutex, &finished, name](curl::CurlAsyncTransfer *)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(name);
+        });
+        return transfer;
+    };
+
+    curlMultiAsync.performTransfer(createTransfer("bulk1", curl::TransferPriority::BULK));
+    EXPECT_TRUE(curlMultiAsync.waitForStarted(1000));
+
+    auto canceledTransfer = createTransfer("bulk2", curl::TransferPriority::BULK);
+    curlMultiAsync.performTransfers({canceledTransfer,
+                                     createTransfer("bulk3", curl::TransferPriority::BULK),
+                                     createTransfer("normal", curl::TransferPriority::NORMAL),
+                                     createTransfer("high", curl::TransferPriority::HIGH)});
+    curlMultiAsync.cancelTransfer(canceledTransfer); // still pending
+
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_THAT(finished, testing::ElementsAre("bulk2", "bulk1", "high", "normal", "bulk3"));
+    EXPECT_EQ(canceledTransfer->asyncResult(), curl::AsyncResult::CANCELED);
+
+    auto bulkStatistics = curlMultiAsync.priorityStatistics(curl::TransferPriority::BULK);
+    EXPECT_EQ(bulkStatistics.queuedTransfers, 0);
+    EXPECT_EQ(bulkStatistics.admittedTransfers, 2);
+    EXPECT_GE(bulkStatistics.maxWait_us, 200000); // bulk3 waited for three transfers
+
+    auto highStatistics = curlMultiAsync.priorityStatistics(curl::TransferPriority::HIGH);
+    EXPECT_EQ(highStatistics.admittedTransfers, 1);
+    EXPECT_LT(highStatistics.maxWait_us, bulkStatistics.maxWait_us);
+}
+
+TEST(CurlMultiAsync, MaxTransfersPerHost)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setMaxTransfersPerHost(1);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::mutex mutex;
+    std::vector<std::string> finished;
+    auto createTransfer = [&](const std::string &host, const std::string &name)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://" + host + ":" + std::to_string(port) + "/" + name);
+        transfer->setTransferCallback([&mutex, &finished, name](curl::CurlAsyncTransfer *)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(name);
+        });
+        return transfer;
+    };
+
+    // the second transfer to 127.0.0.1 has to wait, but doesn't hold up the one to localhost
+    curlMultiAsync.performTransfers({createTransfer("127.0.0.1", "a1"),
+                                     createTransfer("127.0.0.1", "a2"),
+                                     createTransfer("localhost", "b1")});
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(curlMultiAsync.runningTransfers(), 2);
+    EXPECT_EQ(curlMultiAsync.priorityStatistics(curl::TransferPriority::NORMAL).queuedTransfers, 1);
+
+    curlMultiAsync.waitForCompletion();
+    ASSERT_EQ(finished.size(), 3);
+    EXPECT_EQ(finished.back(), "a2");
+}
+
+TEST(CurlMultiAsync, ConnectionPolicy)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    curl::ConnectionPolicy connectionPolicy;
+    connectionPolicy.maxHostConnections = 2;
+    curlMultiAsync.setConnectionPolicy(connectionPolicy);
+    EXPECT_EQ(curlMultiAsync.connectionPolicy().maxHostConnections, 2);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    // All transfers are added to the multi stack at once, but libcurl only opens two connections and queues the rest
+    std::atomic<long> newConnections{0};
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    for(int i = 0; i < 20; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+        transfer->setTransferCallback([&newConnections](curl::CurlAsyncTransfer *transfer)
+        {
+            long connects = 0;
+            curl_easy_getinfo(transfer->curl().handle, CURLINFO_NUM_CONNECTS, &connects);
+            newConnections += connects;
+        });
+        transfers.push_back(transfer);
+    }
+
+    curlMultiAsync.performTransfers(transfers);
+    curlMultiAsync.waitForCompletion();
+
+    for(const auto &transfer : transfers)
+        EXPECT_EQ(transfer->responseCode(), 200);
+
+    EXPECT_EQ(newConnections, 2);
+}
+
+TEST(CurlMultiAsync, CompletionQueue)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger, curl::EventLoop::POLL, curl::CompletionMode::QUEUED);
+    ASSERT_NE(curlMultiAsync.completionFd(), -1);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    const size_t transferCount = 10;
+    std::vector<std::thread::id> callbackThreads;
+    for(size_t i = 0; i < transferCount; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+        transfer->setTransferCallback([&](curl::CurlAsyncTransfer *transfer)
+        {
+            EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+            callbackThreads.push_back(std::this_thread::get_id());
+        });
+        curlMultiAsync.performTransfer(transfer);
+    }
+
+    // nothing runs, until we drain the queue
+    while(curlMultiAsync.queuedCompletions() < transferCount)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_TRUE(callbackThreads.empty());
+    EXPECT_EQ(curlMultiAsync.activeTransfers(), transferCount);
+
+    struct pollfd pfd{curlMultiAsync.completionFd(), POLLIN, 0};
+    EXPECT_EQ(poll(&pfd, 1, 1000), 1);
+
+    EXPECT_EQ(curlMultiAsync.drainCompletions(3), 3);
+    EXPECT_EQ(callbackThreads.size(), 3);
+    EXPECT_EQ(poll(&pfd, 1, 0), 1); // still readable: there are more completions
+
+    EXPECT_EQ(curlMultiAsync.drainCompletions(), transferCount - 3);
+    EXPECT_EQ(poll(&pfd, 1, 0), 0);
+    EXPECT_EQ(curlMultiAsync.drainCompletions(), 0);
+
+    EXPECT_THAT(callbackThreads, testing::Each(std::this_thread::get_id()));
+    EXPECT_EQ(curlMultiAsync.activeTransfers(), 0);
+}
+
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+
+namespace
+{
+
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+}
+
+TEST(CurlMultiAsync, Coroutine)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    // the executor queues the resumptions for this thread
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::deque<std::function<void ()>> tasks;
+    curl::Executor executor = [&](std::function<void ()> task)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        taskAvailable.notify_one();
+    };
+
+    bool finished = false;
+    std::vector<std::thread::id> resumingThreads;
+    std::vector<curl::AsyncResult> results;
+
+    auto coroutine = [&]() -> DetachedCoroutine
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+
+        for(int i = 0; i < 3; i++)
+        {
+            results.push_back(co_await curl::awaitTransfer(curlMultiAsync, transfer, executor));
+            resumingThreads.push_back(std::this_thread::get_id());
+        }
+
+        finished = true;
+    };
+
+    coroutine();
+
+    while(!finished)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(taskAvailable.wait_for(lock, std::chrono::seconds(5), [&]() { return !tasks.empty(); }));
+
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        lock.unlock();
+
+        task();
+    }
+
+    EXPECT_THAT(results, testing::Each(curl::AsyncResult::CURL_DONE));
+    EXPECT_THAT(resumingThreads, testing::Each(std::this_thread::get_id()));
+}
+
+#endif
+
 int main(int argc, char *argv[])
 {
     logger = std::make_shared<cu::StandardOutputLogger>();
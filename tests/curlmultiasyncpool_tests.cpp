@@ -0,0 +1,164 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlmultiasyncpool.hpp"
+#include "libcurl-wrapper/curlasynctransfer.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+extern int port;
+extern cu::Logger logger;
+
+TEST(CurlMultiAsyncPool, StartStop)
+{
+    curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 4);
+    EXPECT_EQ(curlMultiAsyncPool.workerCount(), 4);
+}
+
+TEST(CurlMultiAsyncPool, Transfers)
+{
+    for(auto shardingStrategy : {curl::ShardingStrategy::LEAST_LOADED, curl::ShardingStrategy::HOST_AFFINITY})
+    {
+        curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 4, shardingStrategy);
+
+        httpmock::HttpMockServer mockServer(port);
+        mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+        {
+            connectionData->responseCode = 200;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+
+        mockServer.start();
+        EXPECT_TRUE(mockServer.isRunning());
+
+        std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/get-url";
+        std::atomic<int> callbacks{0};
+        std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+        for(int i = 0; i < 20; i++)
+        {
+            auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+            transfer->setUrl(requestUrl);
+            transfer->setTransferCallback([&](const curl::CurlAsyncTransfer *)
+            {
+                callbacks++;
+            });
+
+            curlMultiAsyncPool.performTransfer(transfer);
+            transfers.push_back(transfer);
+        }
+
+        EXPECT_TRUE(curlMultiAsyncPool.waitForStarted(1000));
+        curlMultiAsyncPool.waitForCompletion();
+
+        EXPECT_EQ(callbacks, 20);
+        EXPECT_EQ(curlMultiAsyncPool.activeTransfers(), 0);
+        for(const auto &transfer : transfers)
+        {
+            EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+            EXPECT_EQ(transfer->responseCode(), 200);
+        }
+
+        EXPECT_TRUE(mockServer.waitForRequestCompleted(20, 1000));
+    }
+}
+
+TEST(CurlMultiAsyncPool, cancelTransfer)
+{
+    curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 4);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+
+    int callbacks = 0;
+    transfer->setTransferCallback([&](const curl::CurlAsyncTransfer *transfer)
+    {
+        callbacks++;
+        EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CANCELED);
+    });
+
+    curlMultiAsyncPool.performTransfer(transfer);
+    EXPECT_TRUE(curlMultiAsyncPool.waitForStarted(1000));
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::RUNNING);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    curlMultiAsyncPool.cancelTransfer(transfer);
+    curlMultiAsyncPool.waitForCompletion();
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CANCELED);
+    EXPECT_EQ(callbacks, 1); // only the owning worker may report the cancellation
+
+    bool success = mockServer.waitForRequestCompleted(1, 1000);
+    EXPECT_TRUE(success);
+}
+
+TEST(CurlMultiAsyncPool, WaitForStarted)
+{
+    curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 4);
+
+    // Nothing runs, so only the deadline ends the wait
+    EXPECT_FALSE(curlMultiAsyncPool.waitForStarted(50));
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+
+    // Woken up by the worker, not after a polling interval
+    auto begin = std::chrono::steady_clock::now();
+    curlMultiAsyncPool.performTransfer(transfer);
+    EXPECT_TRUE(curlMultiAsyncPool.waitForStarted(std::chrono::steady_clock::now() + std::chrono::seconds(1)));
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(90));
+
+    curlMultiAsyncPool.waitForCompletion();
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+}
+
+TEST(CurlMultiAsyncPool, FutureScatterGather)
+{
+    curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 4);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::vector<std::shared_ptr<curl::CurlAsyncTransfer>> transfers;
+    std::vector<std::future<curl::AsyncResult>> results;
+    for(int i = 0; i < 20; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/get-url");
+        transfers.push_back(transfer);
+        results.push_back(curlMultiAsyncPool.performTransferAsync(transfer));
+    }
+
+    // the same semantics as CurlMultiAsync: a pending transfer can't be submitted a second time
+    EXPECT_THROW(curlMultiAsyncPool.performTransferAsync(transfers.front()), std::runtime_error);
+
+    for(size_t i = 0; i < transfers.size(); i++)
+    {
+        EXPECT_EQ(results.at(i).get(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfers.at(i)->responseCode(), 200);
+    }
+}
@@ -0,0 +1,62 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/curlmultiasyncpool.hpp"
+#include "libcurl-wrapper/curlshare.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+extern int port;
+extern cu::Logger logger;
+
+TEST(CurlShare, ReuseConnections)
+{
+    auto share = std::make_shared<curl::CurlShare>(logger, true, true, true);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://localhost:" + std::to_string(port) + "/get-url";
+
+    // Two stacks, which only know each other's connections through the share; they take turns, so sharing connections is safe
+    curl::CurlMultiAsync curlMultiAsync1(logger);
+    curl::CurlMultiAsync curlMultiAsync2(logger);
+    curlMultiAsync1.setShare(share);
+    curlMultiAsync2.setShare(share);
+
+    for(int i = 0; i < 6; i++)
+    {
+        auto &curlMultiAsync = (i % 2) ? curlMultiAsync2 : curlMultiAsync1;
+
+        auto transfer = std::make_shared<curl::CurlAsyncTransfer>(logger);
+        transfer->setUrl(requestUrl);
+        curlMultiAsync.performTransfer(transfer);
+        curlMultiAsync.waitForCompletion();
+
+        EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfer->responseCode(), 200);
+    }
+
+    auto statistics = share->statistics();
+    EXPECT_EQ(statistics.newConnections, 1);
+    EXPECT_EQ(statistics.reusedConnections, 5);
+    EXPECT_EQ(statistics.tlsHandshakes, 0);
+    EXPECT_GT(statistics.lockAcquisitions, 0);
+
+    EXPECT_TRUE(mockServer.waitForRequestCompleted(6, 1000));
+}
+
+TEST(CurlShare, PoolRefusesSharedConnections)
+{
+    curl::CurlMultiAsyncPool curlMultiAsyncPool(logger, 2);
+
+    EXPECT_THROW(curlMultiAsyncPool.setShare(std::make_shared<curl::CurlShare>(logger, true, true, true)), std::runtime_error);
+    EXPECT_NO_THROW(curlMultiAsyncPool.setShare(std::make_shared<curl::CurlShare>(logger)));
+    EXPECT_NO_THROW(curlMultiAsyncPool.setShare(nullptr));
+}
@@ -117,6 +117,18 @@ TEST(Url, SetPagePageWithOverwrite)
     EXPECT_EQ(url.toString() , "http://192.168.101.1:8080/folder/index.html");
 }
 
+TEST(Url, Host)
+{
+    curl::Url url1("http://192.168.101.1:8080/folder/page.html");
+    EXPECT_EQ(url1.host() , "192.168.101.1");
+
+    curl::Url url2("https://Domain.de/index.html");
+    EXPECT_EQ(url2.host() , "Domain.de");
+
+    curl::Url url3;
+    EXPECT_EQ(url3.host() , "");
+}
+
 int main(int argc, char *argv[])
 {
     logger = std::make_shared<cu::StandardOutputLogger>();
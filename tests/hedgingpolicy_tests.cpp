@@ -0,0 +1,170 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/hedgingpolicy.hpp"
+#include "libcurl-wrapper/latencyhistogram.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <atomic>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+// Sends the requests one after the other and returns their latencies in ascending order
+std::vector<std::chrono::milliseconds> measureLatencies(curl::CurlMultiAsync &curlMultiAsync, int requestCount)
+{
+    std::vector<std::chrono::milliseconds> latencies;
+
+    for(int i = 0; i < requestCount; i++)
+    {
+        auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+        transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+
+        auto start = std::chrono::steady_clock::now();
+        curlMultiAsync.performTransfer(transfer);
+        curlMultiAsync.waitForCompletion();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start));
+
+        EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+        EXPECT_EQ(transfer->responseCode(), 200);
+        EXPECT_EQ(std::string(transfer->responseData().begin(), transfer->responseData().end()), "response");
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+}
+
+TEST(HedgingPolicy, LatencyHistogram)
+{
+    curl::LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5).count(), 0);
+
+    for(int i = 1; i <= 100; i++)
+        histogram.record(std::chrono::milliseconds(i));
+
+    EXPECT_EQ(histogram.count(), 100);
+
+    // the buckets are 9% wide
+    EXPECT_NEAR(histogram.percentile(0.5).count(), 50000, 50000 * 0.1);
+    EXPECT_NEAR(histogram.percentile(0.99).count(), 99000, 99000 * 0.1);
+
+    curl::HedgingPolicy hedgingPolicy;
+    hedgingPolicy.setPercentile(0.9);
+    hedgingPolicy.setMinSamples(200);
+
+    std::chrono::microseconds delay;
+    EXPECT_FALSE(hedgingPolicy.hedgeDelay(histogram, delay));
+
+    hedgingPolicy.setMinSamples(100);
+    EXPECT_TRUE(hedgingPolicy.hedgeDelay(histogram, delay));
+    EXPECT_NEAR(delay.count(), 90000, 90000 * 0.1);
+}
+
+TEST(HedgingPolicy, SlowEndpointP99)
+{
+    constexpr int warmupRequests = 30;
+    constexpr int requestCount = 50;
+    std::atomic<int> requests{0};
+    std::atomic<bool> slowRequests{false};
+
+    // Every 10th request hangs: a hedged copy of it is answered quickly
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        if(slowRequests && (++requests % 10 == 0))
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto hedgingPolicy = std::make_shared<curl::HedgingPolicy>();
+    hedgingPolicy->setPercentile(0.9);
+    hedgingPolicy->setMinSamples(warmupRequests);
+    hedgingPolicy->setMinDelay(std::chrono::milliseconds(20));
+
+    curl::CurlMultiAsync plainMultiAsync(logger);
+    curl::CurlMultiAsync hedgingMultiAsync(logger);
+    hedgingMultiAsync.setHedgingPolicy(hedgingPolicy);
+
+    measureLatencies(hedgingMultiAsync, warmupRequests); // fills the histogram of the host
+    EXPECT_EQ(hedgingMultiAsync.hedgingStatistics().hedgedTransfers, 0);
+
+    slowRequests = true;
+    auto plainLatencies = measureLatencies(plainMultiAsync, requestCount);
+    auto hedgedLatencies = measureLatencies(hedgingMultiAsync, requestCount);
+
+    auto p99 = [](const std::vector<std::chrono::milliseconds> &latencies) { return latencies.at(latencies.size() * 99 / 100); };
+    logger->info(fmt::format("p99 without hedging {} ms, with hedging {} ms", p99(plainLatencies).count(), p99(hedgedLatencies).count()));
+
+    EXPECT_GE(p99(plainLatencies).count(), 300);
+    EXPECT_LT(p99(hedgedLatencies).count(), 150);
+
+    auto statistics = hedgingMultiAsync.hedgingStatistics();
+    EXPECT_GE(statistics.hedgedTransfers, 4);
+    EXPECT_GE(statistics.hedgeWins, 4);
+    EXPECT_EQ(hedgingMultiAsync.activeTransfers(), 0);
+}
+
+TEST(HedgingPolicy, FailedOriginalTakesHedgeResult)
+{
+    std::atomic<int> requests{0};
+
+    // The original hangs until its progress timeout, the hedge answers after that, but within its own timeout
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        int request = ++requests;
+        if(request == 2)
+            std::this_thread::sleep_for(std::chrono::milliseconds(4000));
+        else if(request == 3)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+        connectionData->responseCode = 200;
+        connectionData->responseBody = (request == 3) ? "hedge" : "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto hedgingPolicy = std::make_shared<curl::HedgingPolicy>();
+    hedgingPolicy->setMinSamples(1);
+    hedgingPolicy->setMinDelay(std::chrono::milliseconds(2000));
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setHedgingPolicy(hedgingPolicy);
+    measureLatencies(curlMultiAsync, 1);
+
+    // The progress timeout counts whole seconds: the original fails within 3 s, the hedge only after 4 s
+    int callbacks = 0;
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+    transfer->setProgressTimeout_s(1);
+    transfer->setTransferCallback([&callbacks](curl::CurlAsyncTransfer *) { callbacks++; });
+
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+    EXPECT_EQ(transfer->curlResult(), CURLE_OK);
+    EXPECT_EQ(transfer->responseCode(), 200);
+    EXPECT_EQ(std::string(transfer->responseData().begin(), transfer->responseData().end()), "hedge");
+    EXPECT_EQ(callbacks, 1);
+
+    auto statistics = curlMultiAsync.hedgingStatistics();
+    EXPECT_EQ(statistics.hedgedTransfers, 1);
+    EXPECT_EQ(statistics.hedgeWins, 1);
+    EXPECT_EQ(curlMultiAsync.retryStatistics().attempts, 2); // the warmup and the original, not the copy
+    EXPECT_EQ(curlMultiAsync.activeTransfers(), 0);
+}
@@ -0,0 +1,197 @@
+#include "libcurl-wrapper/httpheaders.hpp"
+#include "cpp-utils/stringutils.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <charconv>
+#include <chrono>
+#include <iterator>
+#include <regex>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+
+// Header lines as they arrive in the libcurl header callback, taken from typical JSON API responses
+const std::vector<std::vector<std::string>> headerSets =
+{
+    {
+        "HTTP/1.1 200 OK\r\n",
+        "Date: Tue, 13 Oct 2026 08:15:02 GMT\r\n",
+        "Content-Type: application/json; charset=utf-8\r\n",
+        "Content-Length: 1432\r\n",
+        "Connection: keep-alive\r\n",
+        "Cache-Control: no-cache, no-store, must-revalidate\r\n",
+        "ETag: W/\"598-Fq1dhcq0ddJ3zD8Y3+Wl2NkZ0Yc\"\r\n",
+        "Vary: Accept-Encoding, Origin\r\n",
+        "X-Request-Id: 5f0c7e8a-4c1b-4a8e-9d0b-0a1f3c6e2b7d\r\n",
+        "X-RateLimit-Limit: 1000\r\n",
+        "X-RateLimit-Remaining: 998\r\n",
+        "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n",
+        "\r\n"
+    },
+    {
+        "HTTP/2 201\r\n",
+        "server: nginx\r\n",
+        "date: Tue, 13 Oct 2026 08:15:03 GMT\r\n",
+        "content-type: application/json\r\n",
+        "content-length: 87\r\n",
+        "location: /api/v1/measurements/8131\r\n",
+        "set-cookie: session=2b7d0a1f3c6e; Path=/; HttpOnly; Secure\r\n",
+        "access-control-allow-origin: *\r\n",
+        "\r\n"
+    },
+    {
+        "HTTP/1.1 204 No Content\r\n",
+        "Date: Tue, 13 Oct 2026 08:15:04 GMT\r\n",
+        "Server: Apache\r\n",
+        "\r\n"
+    }
+};
+
+// The implementation of CurlHttpTransfer::onHeaderCallback() before the hand-written parser
+void parseWithRegex(const std::string &line, std::unordered_map<std::string, std::string> &responseHeaders, size_t &contentLength)
+{
+    std::string header = line;
+    cu::trim(header);
+
+    if(header.size() == 0)
+        return;
+
+    auto const regexSplit = std::regex(R"(([\w-]+): *([[:print:]]+))");
+    std::smatch matches;
+    if(std::regex_search(header, matches, regexSplit))
+    {
+        if(matches.size() == 3)
+        {
+            auto headerName = cu::simpleCase(matches[1].str());
+            auto headerValue = matches[2].str();
+            responseHeaders[headerName] = headerValue;
+
+            if(headerName == "Content-Length")
+                contentLength = stol(headerValue);
+        }
+    }
+    else
+    {
+        if(header.rfind("HTTP", 0) == 0)
+        {
+            std::istringstream iss(header);
+            std::vector<std::string> results(std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>());
+            responseHeaders["HTTP-Version"] = results.at(0);
+        }
+    }
+}
+
+void parseWithoutAllocation(std::string_view line, curl::HttpHeaders &responseHeaders, size_t &contentLength)
+{
+    std::string_view headerName;
+    std::string_view headerValue;
+
+    if(curl::parseHeaderLine(line, headerName, headerValue))
+    {
+        responseHeaders.add(headerName, headerValue);
+
+        if(curl::equalsIgnoreCase(headerName, "Content-Length"))
+            std::from_chars(headerValue.data(), headerValue.data() + headerValue.size(), contentLength);
+    }
+    else
+    {
+        std::string_view httpVersion;
+        if(curl::parseStatusLine(line, httpVersion))
+        {
+            responseHeaders.clear();
+            responseHeaders.add("HTTP-Version", httpVersion);
+        }
+    }
+}
+
+}
+
+TEST(HttpHeadersBenchmark, ParseHeaders)
+{
+    const int responses = 5000;
+    size_t contentLengthSum = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < responses; i++)
+    {
+        std::unordered_map<std::string, std::string> responseHeaders;
+        size_t contentLength = 0;
+        for(const auto &line : headerSets[i % headerSets.size()])
+            parseWithRegex(line, responseHeaders, contentLength);
+
+        contentLengthSum += contentLength;
+    }
+    std::chrono::duration<double> regexDuration = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    curl::HttpHeaders responseHeaders;
+    for(int i = 0; i < responses; i++)
+    {
+        responseHeaders.clear();
+        size_t contentLength = 0;
+        for(const auto &line : headerSets[i % headerSets.size()])
+            parseWithoutAllocation(line, responseHeaders, contentLength);
+
+        contentLengthSum -= contentLength;
+    }
+    std::chrono::duration<double> parserDuration = std::chrono::steady_clock::now() - begin;
+
+    EXPECT_EQ(contentLengthSum, 0);
+
+    std::cout << fmt::format("{} responses: std::regex {:.3f} s ({:.2f} us/response), hand-written parser {:.3f} s ({:.2f} us/response)",
+                             responses,
+                             regexDuration.count(), regexDuration.count() * 1e6 / responses,
+                             parserDuration.count(), parserDuration.count() * 1e6 / responses) << std::endl;
+}
+
+// 10k small responses, of which the application looks at one header and misses another one
+TEST(HttpHeadersBenchmark, SmallResponses)
+{
+    const int responses = 10000;
+    size_t found = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < responses; i++)
+    {
+        // eager copy into a map, like the original m_responseHeaders
+        std::unordered_map<std::string, std::string> responseHeaders;
+        for(const auto &line : headerSets[i % headerSets.size()])
+        {
+            std::string_view headerName;
+            std::string_view headerValue;
+            if(curl::parseHeaderLine(line, headerName, headerValue))
+                responseHeaders[cu::simpleCase(std::string(headerName))] = std::string(headerValue);
+        }
+
+        found += responseHeaders.count(cu::simpleCase("content-type"));
+        found += responseHeaders.count(cu::simpleCase("x-missing"));
+    }
+    std::chrono::duration<double> mapDuration = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    curl::HttpHeaders responseHeaders;
+    for(int i = 0; i < responses; i++)
+    {
+        responseHeaders.clear();
+        for(const auto &line : headerSets[i % headerSets.size()])
+        {
+            std::string_view headerName;
+            std::string_view headerValue;
+            if(curl::parseHeaderLine(line, headerName, headerValue))
+                responseHeaders.add(headerName, headerValue);
+        }
+
+        found -= responseHeaders.contains("content-type");
+        found -= responseHeaders.contains("x-missing");
+    }
+    std::chrono::duration<double> arenaDuration = std::chrono::steady_clock::now() - begin;
+
+    EXPECT_EQ(found, 0);
+
+    std::cout << fmt::format("{} responses: std::unordered_map {:.3f} s, HttpHeaders {:.3f} s",
+                             responses, mapDuration.count(), arenaDuration.count()) << std::endl;
+}
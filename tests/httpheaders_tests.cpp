@@ -0,0 +1,124 @@
+#include "libcurl-wrapper/httpheaders.hpp"
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <thread>
+
+TEST(HttpHeaders, ParseHeaderLine)
+{
+    std::string_view name;
+    std::string_view value;
+
+    EXPECT_TRUE(curl::parseHeaderLine("Content-Type: application/json\r\n", name, value));
+    EXPECT_EQ(name, "Content-Type");
+    EXPECT_EQ(value, "application/json");
+
+    EXPECT_TRUE(curl::parseHeaderLine("Content-Description:   Message-ID: 152018 \r\n", name, value));
+    EXPECT_EQ(name, "Content-Description");
+    EXPECT_EQ(value, "Message-ID: 152018");
+
+    EXPECT_TRUE(curl::parseHeaderLine("X-Empty:\r\n", name, value));
+    EXPECT_EQ(name, "X-Empty");
+    EXPECT_EQ(value, "");
+
+    EXPECT_FALSE(curl::parseHeaderLine("HTTP/1.1 200 OK\r\n", name, value));
+    EXPECT_FALSE(curl::parseHeaderLine("\r\n", name, value));
+    EXPECT_FALSE(curl::parseHeaderLine(": value\r\n", name, value));
+    EXPECT_FALSE(curl::parseHeaderLine("  folded: line\r\n", name, value));
+}
+
+TEST(HttpHeaders, ParseStatusLine)
+{
+    std::string_view httpVersion;
+
+    EXPECT_TRUE(curl::parseStatusLine("HTTP/1.1 200 OK\r\n", httpVersion));
+    EXPECT_EQ(httpVersion, "HTTP/1.1");
+
+    EXPECT_TRUE(curl::parseStatusLine("HTTP/2 204\r\n", httpVersion));
+    EXPECT_EQ(httpVersion, "HTTP/2");
+
+    EXPECT_FALSE(curl::parseStatusLine("Content-Type: text/html\r\n", httpVersion));
+}
+
+TEST(HttpHeaders, CaseInsensitiveLookup)
+{
+    curl::HttpHeaders headers;
+    headers.add("content-type", "text/html");
+    headers.add("ETag", "\"abc\"");
+
+    EXPECT_TRUE(headers.contains("Content-Type"));
+    EXPECT_EQ(headers.value("CONTENT-TYPE"), "text/html");
+    EXPECT_EQ(headers.value("etag"), "\"abc\"");
+    EXPECT_FALSE(headers.contains("Content-Length"));
+    EXPECT_EQ(headers.value("Content-Length"), "");
+
+    // the index is rebuilt after adding more headers
+    headers.add("Content-Length", "42");
+    EXPECT_EQ(headers.value("content-length"), "42");
+    EXPECT_EQ(headers.size(), 3);
+
+    headers.clear();
+    EXPECT_TRUE(headers.empty());
+    EXPECT_FALSE(headers.contains("Content-Type"));
+}
+
+TEST(HttpHeaders, MultipleValues)
+{
+    curl::HttpHeaders headers;
+    headers.add("Set-Cookie", "a=1");
+    headers.add("Content-Type", "text/html");
+    headers.add("set-cookie", "b=2");
+    headers.add("Set-Cookie", "c=3");
+
+    auto cookies = headers.values("Set-Cookie");
+    EXPECT_EQ(cookies.size(), 3);
+    EXPECT_THAT(std::vector<std::string_view>(cookies.begin(), cookies.end()), testing::ElementsAre("a=1", "b=2", "c=3"));
+
+    EXPECT_EQ(headers.value("Set-Cookie"), "c=3"); // the last one
+    EXPECT_TRUE(headers.values("Location").empty());
+}
+
+TEST(HttpHeaders, Iteration)
+{
+    curl::HttpHeaders headers;
+    headers.add("B", "2");
+    headers.add("A", "1");
+    headers.add("B", "3");
+
+    std::vector<std::string> received;
+    for(const auto &[name, value] : headers)
+        received.push_back(std::string(name) + "=" + std::string(value));
+
+    // in the order of arrival, not in the order of the index
+    EXPECT_THAT(received, testing::ElementsAre("B=2", "A=1", "B=3"));
+}
+
+TEST(HttpHeaders, ConcurrentLookupsAfterBuildIndex)
+{
+    curl::HttpHeaders headers;
+    for(int i = 0; i < 100; i++)
+        headers.add("X-Header-" + std::to_string(i), std::to_string(i));
+
+    // Like CurlHttpTransfer, when the transfer is finished: the lookups below only read
+    headers.buildIndex();
+
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for(int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&]()
+        {
+            for(int i = 0; i < 100; i++)
+            {
+                if(headers.value("x-header-" + std::to_string(i)) != std::to_string(i))
+                    mismatches++;
+            }
+        });
+    }
+
+    for(auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(mismatches, 0);
+}
@@ -0,0 +1,206 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/mappedtracepool.hpp"
+#include "libcurl-wrapper/traceconfiguration.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+const std::string poolFilename = "/tmp/libcurl-wrapper-trace-pool-test.ctp";
+
+void traceTransfer(const std::shared_ptr<curl::MappedTracePool> &pool, uint64_t transferId, int records, size_t recordSize = 100)
+{
+    std::vector<char> data(recordSize, 'x');
+
+    curl::MappedTraceFile traceFile(logger, pool);
+    traceFile.setTransferId(transferId);
+    traceFile.initialize();
+
+    traceFile.traceMessage(fmt::format("### Transfer {} ###\n", transferId));
+    for(int i = 0; i < records; i++)
+        traceFile.traceCurlDebugInfo(nullptr, CURLINFO_DATA_OUT, data.data(), data.size());
+
+    traceFile.finalize();
+}
+
+}
+
+TEST(MappedTracePool, KeepsTheLastTransfers)
+{
+    unlink(poolFilename.c_str());
+    auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 4, 4096);
+
+    for(uint64_t transferId = 1; transferId <= 10; transferId++)
+        traceTransfer(pool, transferId, 2);
+
+    // The file never grows: the oldest slots are reused
+    struct stat fileStatus;
+    ASSERT_EQ(stat(poolFilename.c_str(), &fileStatus), 0);
+    EXPECT_EQ(fileStatus.st_size, 64 + 4 * 4096);
+
+    auto slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    ASSERT_EQ(slots.size(), 4);
+    for(size_t i = 0; i < slots.size(); i++)
+    {
+        EXPECT_EQ(slots[i].transferId, 7 + i);
+        EXPECT_EQ(slots[i].droppedRecords, 0);
+        ASSERT_EQ(slots[i].records.size(), 3);
+        EXPECT_EQ(slots[i].records[0].kind, curl::BinaryTraceRecordKind::MESSAGE);
+        EXPECT_EQ(slots[i].records[1].type, CURLINFO_DATA_OUT);
+        EXPECT_EQ(slots[i].records[1].data.size(), 100);
+    }
+
+    unlink(poolFilename.c_str());
+}
+
+TEST(MappedTracePool, FullSlot)
+{
+    unlink(poolFilename.c_str());
+    auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 2, 4096);
+
+    // 64 bytes slot header, 28 bytes per record header: 31 records of 100 bytes fit behind the message
+    traceTransfer(pool, 1, 40);
+
+    auto slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    ASSERT_EQ(slots.size(), 1);
+    EXPECT_EQ(slots[0].records.size(), 1 + 31);
+    EXPECT_EQ(slots[0].droppedRecords, 9);
+
+    unlink(poolFilename.c_str());
+}
+
+TEST(MappedTracePool, AllSlotsInUse)
+{
+    unlink(poolFilename.c_str());
+    auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 2, 4096);
+
+    curl::MappedTraceFile first(logger, pool), second(logger, pool), third(logger, pool);
+    first.initialize();
+    second.initialize();
+    third.initialize();
+    third.traceMessage("not traced");
+
+    EXPECT_EQ(pool->skippedTransfers(), 1);
+
+    first.finalize();
+    third.initialize();
+    third.traceMessage("traced");
+    EXPECT_EQ(pool->skippedTransfers(), 1);
+
+    unlink(poolFilename.c_str());
+}
+
+TEST(MappedTracePool, Reopen)
+{
+    unlink(poolFilename.c_str());
+
+    {
+        auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 4, 4096);
+        for(uint64_t transferId = 1; transferId <= 6; transferId++)
+            traceTransfer(pool, transferId, 1);
+    }
+
+    // The same geometry keeps the traces, the oldest one is overwritten first
+    {
+        auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 4, 4096);
+        traceTransfer(pool, 7, 1);
+    }
+
+    auto slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    ASSERT_EQ(slots.size(), 4);
+    for(size_t i = 0; i < slots.size(); i++)
+        EXPECT_EQ(slots[i].transferId, 4 + i);
+
+    // Another geometry starts over
+    {
+        auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 2, 4096);
+        traceTransfer(pool, 8, 1);
+    }
+
+    slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    ASSERT_EQ(slots.size(), 1);
+    EXPECT_EQ(slots[0].transferId, 8);
+
+    unlink(poolFilename.c_str());
+}
+
+TEST(MappedTracePool, SurvivesCrash)
+{
+    unlink(poolFilename.c_str());
+    auto pool = std::make_shared<curl::MappedTracePool>(logger, poolFilename, 4, 4096);
+
+    // The child dies in the middle of the transfer: no finalize, no destructor, no msync
+    pid_t child = fork();
+    ASSERT_NE(child, -1);
+    if(child == 0)
+    {
+        auto traceFile = new curl::MappedTraceFile(logger, pool);
+        traceFile->setTransferId(42);
+        traceFile->initialize();
+        traceFile->traceMessage("### before the crash ###\n");
+        _exit(0);
+    }
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+
+    auto slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    ASSERT_EQ(slots.size(), 1);
+    EXPECT_EQ(slots[0].transferId, 42);
+    ASSERT_EQ(slots[0].records.size(), 1);
+    EXPECT_EQ(std::string(slots[0].records[0].data.begin(), slots[0].records[0].data.end()), "### before the crash ###\n");
+
+    unlink(poolFilename.c_str());
+}
+
+TEST(MappedTracePool, TraceTransfer)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 200;
+        connectionData->responseBody = "response";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    unlink(poolFilename.c_str());
+    auto traceConfiguration = std::make_shared<curl::TraceConfiguration>(logger);
+    traceConfiguration->setMappedTracePool(std::make_shared<curl::MappedTracePool>(logger, poolFilename, 4, 64 * 1024));
+    traceConfiguration->enableTracing();
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    curlMultiAsync.setTraceConfiguration(traceConfiguration);
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/trace-pool");
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    EXPECT_EQ(transfer->responseCode(), 200);
+
+    auto slots = curl::MappedTracePool::readSlots(logger, poolFilename);
+    unlink(poolFilename.c_str());
+    ASSERT_EQ(slots.size(), 1);
+    EXPECT_EQ(slots[0].transferId, transfer->transferId());
+
+    std::ostringstream text;
+    for(auto &record : slots[0].records)
+        curl::BinaryTraceReader::writeText(text, record, slots[0].maxDataSize);
+
+    EXPECT_THAT(text.str(), testing::StartsWith("### Timestamp: "));
+    EXPECT_THAT(text.str(), testing::HasSubstr("GET /trace-pool HTTP/1.1"));
+    EXPECT_THAT(text.str(), testing::EndsWith("### Response Code: 200 ###\n"));
+}
@@ -0,0 +1,32 @@
+#include "libcurl-wrapper/responsesink.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+
+// Feeds a body without Content-Length in write callback sized pieces, like libcurl does
+TEST(ResponseSinkBenchmark, AppendWithoutContentLength)
+{
+    const size_t bodySize = 256 * 1024 * 1024;
+    const size_t pieceSize = 16 * 1024; // CURL_MAX_WRITE_SIZE
+    std::vector<char> piece(pieceSize, 'x');
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<char> responseData;
+    for(size_t written = 0; written < bodySize; written += pieceSize)
+        responseData.insert(responseData.end(), piece.data(), piece.data() + pieceSize);
+    std::chrono::duration<double> vectorDuration = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    curl::ChunkedBufferSink sink(1024 * 1024);
+    sink.begin();
+    for(size_t written = 0; written < bodySize; written += pieceSize)
+        sink.write(piece.data(), pieceSize);
+    std::chrono::duration<double> sinkDuration = std::chrono::steady_clock::now() - begin;
+
+    EXPECT_EQ(responseData.size(), sink.size());
+
+    std::cout << fmt::format("{} MiB: std::vector<char> {:.3f} s, ChunkedBufferSink {:.3f} s ({} chunks)",
+                             bodySize / (1024 * 1024), vectorDuration.count(), sinkDuration.count(), sink.chunks().size()) << std::endl;
+}
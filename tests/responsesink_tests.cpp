@@ -0,0 +1,131 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/responsesink.hpp"
+
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+TEST(ResponseSink, ChunkedBuffer)
+{
+    curl::ChunkedBufferSink sink(4);
+    sink.begin();
+
+    EXPECT_TRUE(sink.write("abc", 3));
+    EXPECT_TRUE(sink.write("defghi", 6));
+    EXPECT_TRUE(sink.write("j", 1));
+
+    EXPECT_EQ(sink.size(), 10);
+    EXPECT_EQ(sink.toString(), "abcdefghij");
+    EXPECT_THAT(sink.chunks(), testing::ElementsAre("abcd", "efghi", "j"));
+
+    // with a size hint everything ends up in one chunk
+    sink.begin();
+    sink.sizeHint(10);
+    EXPECT_TRUE(sink.write("abcdefghij", 10));
+    EXPECT_THAT(sink.chunks(), testing::ElementsAre("abcdefghij"));
+
+    // a bogus Content-Length must not allocate its size
+    sink.begin();
+    sink.sizeHint(std::numeric_limits<size_t>::max());
+    EXPECT_TRUE(sink.write("abcdefghij", 10));
+    EXPECT_EQ(sink.toString(), "abcdefghij");
+}
+
+TEST(ResponseSink, FixedBuffer)
+{
+    char buffer[8];
+    curl::FixedBufferSink sink(buffer, sizeof(buffer));
+
+    sink.begin();
+    EXPECT_TRUE(sink.write("abcd", 4));
+    EXPECT_TRUE(sink.write("efgh", 4));
+    EXPECT_EQ(sink.data(), "abcdefgh");
+    EXPECT_FALSE(sink.overflow());
+
+    EXPECT_FALSE(sink.write("i", 1));
+    EXPECT_TRUE(sink.overflow());
+
+    sink.begin();
+    EXPECT_EQ(sink.size(), 0);
+    EXPECT_FALSE(sink.overflow());
+}
+
+TEST(ResponseSink, FileDescriptor)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    curl::FileDescriptorSink sink(fds[1]);
+    EXPECT_TRUE(sink.write("abc", 3));
+
+    char buffer[3];
+    EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), 3);
+    EXPECT_EQ(std::string(buffer, 3), "abc");
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ResponseSink, Transfer)
+{
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    std::string response(100000, 'x');
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseBody = response;
+        connectionData->responseCode = 200;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    std::string requestUrl = "http://127.0.0.1:" + std::to_string(port) + "/sink";
+
+    // streaming callback
+    size_t streamedBytes = 0;
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl(requestUrl);
+    transfer->setResponseSink(std::make_shared<curl::CallbackSink>([&](const char *data, size_t size)
+    {
+        streamedBytes += std::count(data, data + size, 'x');
+        return true;
+    }));
+
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->curlResult(), CURLE_OK) << curl_easy_strerror(transfer->curlResult());
+    EXPECT_EQ(streamedBytes, response.size());
+    EXPECT_TRUE(transfer->responseData().empty());
+
+    // chunked buffer
+    auto chunkedSink = std::make_shared<curl::ChunkedBufferSink>();
+    transfer->setResponseSink(chunkedSink);
+
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->curlResult(), CURLE_OK) << curl_easy_strerror(transfer->curlResult());
+    EXPECT_EQ(chunkedSink->chunks().size(), 1); // sized by Content-Length
+    EXPECT_EQ(chunkedSink->toString(), response);
+
+    // the fixed buffer is too small: the transfer is aborted
+    std::vector<char> buffer(1000);
+    auto fixedSink = std::make_shared<curl::FixedBufferSink>(buffer.data(), buffer.size());
+    transfer->setResponseSink(fixedSink);
+
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->curlResult(), CURLE_WRITE_ERROR);
+    EXPECT_TRUE(fixedSink->overflow());
+}
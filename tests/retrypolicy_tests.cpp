@@ -0,0 +1,166 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/retrypolicy.hpp"
+
+#include <fmt/core.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+
+extern int port;
+extern cu::Logger logger;
+
+TEST(RetryPolicy, Backoff)
+{
+    curl::RetryPolicy retryPolicy;
+    retryPolicy.setBackoff(std::chrono::milliseconds(100), 2.0, std::chrono::milliseconds(1000));
+    retryPolicy.setJitter(0.0);
+
+    EXPECT_EQ(retryPolicy.backoff(1).count(), 100);
+    EXPECT_EQ(retryPolicy.backoff(2).count(), 200);
+    EXPECT_EQ(retryPolicy.backoff(3).count(), 400);
+    EXPECT_EQ(retryPolicy.backoff(5).count(), 1000); // capped
+
+    retryPolicy.setJitter(0.5);
+    for(int i = 0; i < 100; i++)
+    {
+        auto backoff = retryPolicy.backoff(2).count();
+        EXPECT_GE(backoff, 100);
+        EXPECT_LE(backoff, 200);
+    }
+}
+
+TEST(RetryPolicy, RecoverAfterServerErrors)
+{
+    std::atomic<int> requests{0};
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = (++requests < 3) ? 503 : 200;
+        connectionData->responseBody = fmt::format("request {}", requests.load());
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto retryPolicy = std::make_shared<curl::RetryPolicy>();
+    retryPolicy->setBackoff(std::chrono::milliseconds(50));
+    retryPolicy->setJitter(0.0);
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    int callbacks = 0;
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+    transfer->setRetryPolicy(retryPolicy);
+    transfer->setTransferCallback([&callbacks](curl::CurlAsyncTransfer *) { callbacks++; });
+
+    auto start = std::chrono::steady_clock::now();
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+    EXPECT_EQ(transfer->responseCode(), 200);
+    EXPECT_EQ(std::string(transfer->responseData().begin(), transfer->responseData().end()), "request 3");
+    EXPECT_EQ(transfer->attempts(), 3);
+    EXPECT_EQ(callbacks, 1);
+    EXPECT_GE(elapsed.count(), 150); // 50 + 100 ms backoff
+
+    auto statistics = curlMultiAsync.retryStatistics();
+    EXPECT_EQ(statistics.attempts, 3);
+    EXPECT_EQ(statistics.retries, 2);
+    EXPECT_EQ(statistics.recoveredTransfers, 1);
+    EXPECT_EQ(statistics.exhaustedTransfers, 0);
+    EXPECT_EQ(statistics.nonIdempotentFailures, 0);
+    EXPECT_EQ(statistics.scheduledRetries, 0);
+
+    // A new submission starts counting again
+    requests = 2;
+    curlMultiAsync.performTransfer(transfer);
+    curlMultiAsync.waitForCompletion();
+    EXPECT_EQ(transfer->responseCode(), 200);
+    EXPECT_EQ(transfer->attempts(), 1);
+}
+
+TEST(RetryPolicy, ExhaustedAndNonIdempotent)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 502;
+        connectionData->responseHeader["Retry-After"] = "0";
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto retryPolicy = std::make_shared<curl::RetryPolicy>();
+    retryPolicy->setMaxAttempts(2);
+    retryPolicy->setBackoff(std::chrono::milliseconds(10));
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    auto getTransfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    getTransfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+    getTransfer->setRetryPolicy(retryPolicy);
+
+    std::string postData = "payload";
+    auto postTransfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    postTransfer->setUrl("http://localhost:" + std::to_string(port) + "/post-url");
+    postTransfer->setPostData(postData.data(), postData.size());
+    postTransfer->setRetryPolicy(retryPolicy);
+
+    curlMultiAsync.performTransfers({getTransfer, postTransfer});
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(getTransfer->responseCode(), 502);
+    EXPECT_EQ(getTransfer->attempts(), 2);
+    EXPECT_EQ(postTransfer->responseCode(), 502);
+    EXPECT_EQ(postTransfer->attempts(), 1); // a POST is not sent twice
+
+    auto statistics = curlMultiAsync.retryStatistics();
+    EXPECT_EQ(statistics.attempts, 3);
+    EXPECT_EQ(statistics.retries, 1);
+    EXPECT_EQ(statistics.exhaustedTransfers, 1);    // only the GET used up its attempts
+    EXPECT_EQ(statistics.nonIdempotentFailures, 1);
+}
+
+TEST(RetryPolicy, CancelScheduledRetry)
+{
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.setGenerateResponseCallback([&](httpmock::ConnectionData *connectionData)
+    {
+        connectionData->responseCode = 503;
+    });
+
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    auto retryPolicy = std::make_shared<curl::RetryPolicy>();
+    retryPolicy->setBackoff(std::chrono::seconds(10));
+    retryPolicy->setJitter(0.0);
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://localhost:" + std::to_string(port) + "/get-url");
+    transfer->setRetryPolicy(retryPolicy);
+
+    curlMultiAsync.performTransfer(transfer);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while((curlMultiAsync.retryStatistics().scheduledRetries == 0) && (std::chrono::steady_clock::now() < deadline))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    EXPECT_EQ(curlMultiAsync.retryStatistics().scheduledRetries, 1);
+    EXPECT_EQ(curlMultiAsync.activeTransfers(), 1); // still active during the backoff
+
+    curlMultiAsync.cancelTransfer(transfer);
+    EXPECT_TRUE(curlMultiAsync.waitForCompletion(std::chrono::steady_clock::now() + std::chrono::seconds(1)));
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CANCELED);
+    EXPECT_EQ(transfer->attempts(), 1);
+    EXPECT_EQ(curlMultiAsync.retryStatistics().scheduledRetries, 0);
+}
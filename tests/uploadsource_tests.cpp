@@ -0,0 +1,211 @@
+#include "httpmockserver/httpmockserver.hpp"
+#include "libcurl-wrapper/curlmultiasync.hpp"
+#include "libcurl-wrapper/curlhttptransfer.hpp"
+#include "libcurl-wrapper/uploadsource.hpp"
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern int port;
+extern cu::Logger logger;
+
+namespace
+{
+
+std::string createContent(size_t size)
+{
+    std::string content;
+    content.reserve(size);
+    static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    for(size_t i = 0; i < size; ++i)
+        content += alphabet[rand() % (sizeof(alphabet) - 1)];
+
+    return content;
+}
+
+// POSTs the body of the source and returns what the server received
+std::string postUploadSource(curl::CurlMultiAsync &curlMultiAsync, httpmock::HttpMockServer &mockServer, std::shared_ptr<curl::UploadSource> uploadSource,
+                             const std::function<void (std::shared_ptr<curl::CurlHttpTransfer>)> &producer = nullptr)
+{
+    auto transfer = std::make_shared<curl::CurlHttpTransfer>(logger);
+    transfer->setUrl("http://127.0.0.1:" + std::to_string(port) + "/upload-source");
+    transfer->setUploadSource(uploadSource);
+
+    curlMultiAsync.performTransfer(transfer);
+    if(producer)
+        producer(transfer);
+    curlMultiAsync.waitForCompletion();
+
+    EXPECT_EQ(transfer->asyncResult(), curl::AsyncResult::CURL_DONE);
+    EXPECT_EQ(transfer->curlResult(), CURLE_OK) << curl_easy_strerror(transfer->curlResult());
+    EXPECT_EQ(transfer->responseCode(), 200);
+
+    if(!mockServer.waitForRequestCompleted(1, 1000))
+        return std::string();
+
+    EXPECT_EQ(mockServer.lastConnectionData()->httpMethod, httpmock::HttpMethod::PostRawData);
+    const auto &postData = mockServer.lastConnectionData()->postData;
+    return std::string(postData.begin(), postData.end());
+}
+
+}
+
+TEST(UploadSource, Memory)
+{
+    std::string content = createContent(100 * 1024);
+
+    curl::MemoryUploadSource source(content.data(), content.size());
+    EXPECT_EQ(source.size(), content.size());
+
+    char buffer[60 * 1024];
+    EXPECT_EQ(source.read(buffer, sizeof(buffer)), sizeof(buffer));
+    EXPECT_EQ(source.read(buffer, sizeof(buffer)), content.size() - sizeof(buffer));
+    EXPECT_EQ(source.read(buffer, sizeof(buffer)), 0);
+    EXPECT_TRUE(source.rewind());
+    EXPECT_EQ(source.read(buffer, 3), 3);
+    EXPECT_EQ(std::string_view(buffer, 3), content.substr(0, 3));
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    auto uploadSource = std::make_shared<curl::MemoryUploadSource>(content.data(), content.size());
+    EXPECT_EQ(postUploadSource(curlMultiAsync, mockServer, uploadSource), content);
+    EXPECT_EQ(mockServer.lastConnectionData()->header["Content-Length"], std::to_string(content.size()));
+}
+
+TEST(UploadSource, GeneratorWithUnknownSize)
+{
+    std::string content = createContent(1024 * 1024 + 17);
+    size_t offset = 0;
+
+    auto uploadSource = std::make_shared<curl::GeneratorUploadSource>([&](char *buffer, size_t capacity)
+    {
+        size_t bytes = std::min<size_t>({capacity, 1000, content.size() - offset}); // like a compressor, which produces small pieces
+        std::memcpy(buffer, content.data() + offset, bytes);
+        offset += bytes;
+        return bytes;
+    });
+    EXPECT_EQ(uploadSource->size(), -1);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    EXPECT_EQ(postUploadSource(curlMultiAsync, mockServer, uploadSource), content);
+    EXPECT_EQ(mockServer.lastConnectionData()->header["Transfer-Encoding"], "chunked");
+
+    // Without a rewind callback the body can't be sent a second time
+    EXPECT_FALSE(uploadSource->rewind());
+}
+
+TEST(UploadSource, PauseAndResume)
+{
+    for(auto eventLoop : {curl::EventLoop::POLL, curl::EventLoop::SOCKET_ACTION})
+    {
+        std::string content = createContent(256 * 1024);
+        const size_t pieceSize = 16 * 1024;
+
+        // The producer appends pieces from another thread: the source pauses the transfer, while it has nothing to send
+        std::mutex mutex;
+        std::string produced;
+        size_t offset = 0;
+        bool finished = false;
+        int pauses = 0;
+
+        auto uploadSource = std::make_shared<curl::GeneratorUploadSource>([&](char *buffer, size_t capacity)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if(offset == produced.size())
+            {
+                if(finished)
+                    return size_t(0);
+
+                pauses++;
+                return curl::UploadSource::readPause;
+            }
+
+            size_t bytes = std::min(capacity, produced.size() - offset);
+            std::memcpy(buffer, produced.data() + offset, bytes);
+            offset += bytes;
+            return bytes;
+        });
+
+        httpmock::HttpMockServer mockServer(port);
+        mockServer.start();
+        EXPECT_TRUE(mockServer.isRunning());
+
+        curl::CurlMultiAsync curlMultiAsync(logger, eventLoop);
+        auto received = postUploadSource(curlMultiAsync, mockServer, uploadSource, [&](std::shared_ptr<curl::CurlHttpTransfer> transfer)
+        {
+            for(size_t i = 0; i < content.size(); i += pieceSize)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                {
+                    const std::lock_guard<std::mutex> lock(mutex);
+                    produced.append(content, i, pieceSize);
+                    finished = (produced.size() == content.size());
+                }
+                curlMultiAsync.resumeTransfer(transfer);
+            }
+        });
+
+        EXPECT_EQ(received, content);
+        EXPECT_GE(pauses, 1);
+    }
+}
+
+TEST(UploadSource, FileDescriptor)
+{
+    std::string content = createContent(300 * 1024);
+
+    char fileName[] = "/tmp/libcurl-wrapper-upload-XXXXXX";
+    int fd = mkstemp(fileName);
+    ASSERT_NE(fd, -1);
+    unlink(fileName);
+    ASSERT_EQ(write(fd, content.data(), content.size()), content.size());
+    ASSERT_EQ(lseek(fd, 100, SEEK_SET), 100);
+
+    httpmock::HttpMockServer mockServer(port);
+    mockServer.start();
+    EXPECT_TRUE(mockServer.isRunning());
+
+    // A file is sent from the current offset on; its size is known
+    curl::CurlMultiAsync curlMultiAsync(logger);
+    auto uploadSource = std::make_shared<curl::FileDescriptorUploadSource>(fd);
+    EXPECT_EQ(uploadSource->size(), content.size() - 100);
+    EXPECT_EQ(postUploadSource(curlMultiAsync, mockServer, uploadSource), content.substr(100));
+    EXPECT_EQ(postUploadSource(curlMultiAsync, mockServer, uploadSource), content.substr(100)); // rewound
+    close(fd);
+
+    // A nonblocking pipe pauses the transfer until the writer resumes it
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    uploadSource = std::make_shared<curl::FileDescriptorUploadSource>(fds[0]);
+    EXPECT_EQ(uploadSource->size(), -1);
+    auto received = postUploadSource(curlMultiAsync, mockServer, uploadSource, [&](std::shared_ptr<curl::CurlHttpTransfer> transfer)
+    {
+        const size_t pieceSize = 4096;
+        for(size_t i = 0; i < content.size(); i += pieceSize)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            size_t bytes = std::min(pieceSize, content.size() - i);
+            ASSERT_EQ(write(fds[1], content.data() + i, bytes), bytes);
+            curlMultiAsync.resumeTransfer(transfer);
+        }
+
+        close(fds[1]);
+        curlMultiAsync.resumeTransfer(transfer);
+    });
+    close(fds[0]);
+
+    EXPECT_EQ(received, content);
+}
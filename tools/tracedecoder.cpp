@@ -0,0 +1,101 @@
+#include "libcurl-wrapper/binarytracefile.hpp"
+#include "libcurl-wrapper/mappedtracepool.hpp"
+
+#include <fmt/core.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+bool isTracePool(const std::string &filename)
+{
+    char magic[4] = {};
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    file.read(magic, sizeof(magic));
+    return file && (std::memcmp(magic, "CTP1", sizeof(magic)) == 0);
+}
+
+// The slots of a trace pool (.ctp), oldest first
+void printTracePool(const cu::Logger &logger, const std::string &filename, bool printTransferIds)
+{
+    for(auto &slot : curl::MappedTracePool::readSlots(logger, filename))
+    {
+        std::cout << fmt::format("### Trace slot {}: sequence {}, transfer {}, {} records, {} dropped ###\n",
+                                 slot.index, slot.sequence, slot.transferId, slot.records.size(), slot.droppedRecords);
+
+        for(auto &record : slot.records)
+        {
+            if(printTransferIds && (record.kind == curl::BinaryTraceRecordKind::CURL_DEBUG_INFO))
+                std::cout << "[" << record.transferId << "] ";
+
+            curl::BinaryTraceReader::writeText(std::cout, record, slot.maxDataSize);
+        }
+    }
+}
+
+}
+
+// Renders binary trace files (.ctb) and trace pools (.ctp) in the text layout of TraceFile (.ctf)
+int main(int argc, char *argv[])
+{
+    bool printTransferIds = false;
+    std::vector<std::string> filenames;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--transfer-ids") == 0)
+            printTransferIds = true;
+        else if(argv[i][0] == '-')
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        else
+            filenames.emplace_back(argv[i]);
+    }
+
+    if(filenames.empty())
+    {
+        std::cerr << fmt::format("usage: {} [--transfer-ids] <trace.ctb|trace.ctp>...", argv[0]) << std::endl;
+        return 1;
+    }
+
+    cu::Logger logger = std::make_shared<cu::NullLogger>(); // errors are reported by the exceptions
+    curl::BinaryTraceRecord record;
+
+    for(const auto &filename : filenames)
+    {
+        try
+        {
+            if(isTracePool(filename))
+            {
+                printTracePool(logger, filename, printTransferIds);
+                continue;
+            }
+
+            curl::BinaryTraceReader reader(logger);
+            reader.open(filename);
+
+            while(reader.next(record))
+            {
+                if(printTransferIds && (record.kind == curl::BinaryTraceRecordKind::CURL_DEBUG_INFO))
+                    std::cout << "[" << record.transferId << "] ";
+
+                reader.writeText(std::cout, record);
+            }
+        }
+        catch(std::exception &e)
+        {
+            std::cout.flush();
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    return 0;
+}
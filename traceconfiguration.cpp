@@ -1,10 +1,13 @@
 #include "libcurl-wrapper/traceconfiguration.hpp"
 #include "libcurl-wrapper/tracefile.hpp"
+#include "libcurl-wrapper/binarytracefile.hpp"
+#include "libcurl-wrapper/mappedtracepool.hpp"
 #include "libcurl-wrapper/curlasynctransfer.hpp"
 #include "cpp-utils/timeutils.hpp"
 
 #include <fmt/core.h>
 
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <ctime>
@@ -23,16 +26,134 @@ void TraceConfiguration::configureTracing(std::shared_ptr<CurlAsyncTransfer> tra
     if(m_transfersToTrace == 0) // disabled
         return;
 
+    if(m_enableConditionalCapture)
+    {
+        std::weak_ptr<TraceConfiguration> self = weak_from_this();
+        if(self.expired())
+        {
+            m_logger->warning("conditional trace capture needs a TraceConfiguration owned by a std::shared_ptr");
+            return;
+        }
+
+        auto writer = [self](uint64_t transferId, uint32_t maxDataSize, const std::vector<char> &records)
+        {
+            if(auto configuration = self.lock())
+                configuration->writeCapturedTrace(transferId, maxDataSize, records);
+        };
+
+        std::unique_ptr<ConditionalTraceCapture> tracer = std::make_unique<ConditionalTraceCapture>(m_logger, m_capturePolicy, std::move(writer));
+
+        tracer->setMaxDataSize(m_maxDataSize);
+        tracer->enableSslData(m_enableSslData);
+        tracer->setTransferId(transfer->transferId());
+
+        transfer->setTracing(std::move(tracer));
+        return;
+    }
+
+    if(m_mappedTracePool)
+    {
+        std::unique_ptr<MappedTraceFile> tracer = std::make_unique<MappedTraceFile>(m_logger, m_mappedTracePool);
+
+        if(m_transfersToTrace > 0) // -1 => continuous tracing
+            m_transfersToTrace--;
+
+        tracer->setMaxDataSize(m_maxDataSize);
+        tracer->enableSslData(m_enableSslData);
+        tracer->setTransferId(transfer->transferId());
+
+        transfer->setTracing(std::move(tracer));
+        return;
+    }
+
+    if(m_traceFormat == TraceFormat::BINARY)
+    {
+        std::unique_ptr<BinaryTraceFile> tracer = std::make_unique<BinaryTraceFile>(m_logger);
+
+        tracer->setFilename(generateNextFilename("ctb"));
+        tracer->setMaxDataSize(m_maxDataSize);
+        tracer->enableSslData(m_enableSslData);
+        tracer->enableCompression(m_enableCompression);
+        tracer->setTransferId(transfer->transferId());
+
+        transfer->setTracing(std::move(tracer));
+        return;
+    }
+
+    if(m_asyncTraceWriter)
+    {
+        std::unique_ptr<AsyncTraceFile> tracer = std::make_unique<AsyncTraceFile>(m_logger, m_asyncTraceWriter);
+
+        tracer->setFilename(generateNextFilename("ctf"));
+        tracer->setMaxDataSize(m_maxDataSize);
+        tracer->enableSslData(m_enableSslData);
+
+        transfer->setTracing(std::move(tracer));
+        return;
+    }
+
     std::unique_ptr<TraceFile> tracer = std::make_unique<TraceFile>(m_logger);
 
-    tracer->setFilename(generateNextFilename());
+    tracer->setFilename(generateNextFilename("ctf"));
     tracer->setMaxDataSize(m_maxDataSize);
     tracer->enableSslData(m_enableSslData);
 
     transfer->setTracing(std::move(tracer));
 }
 
-std::string TraceConfiguration::generateNextFilename()
+void TraceConfiguration::writeCapturedTrace(uint64_t transferId, uint32_t maxDataSize, const std::vector<char> &records)
+{
+    std::lock_guard<std::mutex> lock(m_captureMutex);
+
+    if(m_transfersToTrace == 0) // the limit was reached by other transfers meanwhile
+        return;
+
+    if(m_mappedTracePool)
+    {
+        if(m_transfersToTrace > 0)
+            m_transfersToTrace--;
+
+        MappedTraceFile tracer(m_logger, m_mappedTracePool);
+        tracer.setTransferId(transferId);
+        tracer.setMaxDataSize(maxDataSize);
+        tracer.initialize();
+        tracer.appendEncodedRecords(records.data(), records.size());
+        tracer.finalize();
+        return;
+    }
+
+    if(m_traceFormat == TraceFormat::BINARY)
+    {
+        BinaryTraceFile tracer(m_logger);
+        tracer.setFilename(generateNextFilename("ctb"));
+        tracer.setMaxDataSize(maxDataSize);
+        tracer.enableCompression(m_enableCompression);
+        tracer.setTransferId(transferId);
+        tracer.initialize();
+        tracer.appendEncodedRecords(records.data(), records.size());
+        tracer.finalize();
+        return;
+    }
+
+    // The same text as TraceFile, but written at once: the transfer is finished already
+    std::string filename = generateNextFilename("ctf");
+    m_logger->info(fmt::format("create trace file: {}", filename));
+
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        std::string errMsg = fmt::format("failed to open trace file {}", filename);
+        m_logger->error(errMsg);
+        throw std::runtime_error(errMsg);
+    }
+
+    size_t offset = 0;
+    BinaryTraceRecord record;
+    while(BinaryTraceReader::decodeRecord(records.data(), records.size(), offset, record))
+        BinaryTraceReader::writeText(file, record, maxDataSize);
+}
+
+std::string TraceConfiguration::generateNextFilename(const char *extension)
 {
     std::string filename;
 
@@ -41,7 +162,7 @@ std::string TraceConfiguration::generateNextFilename()
 
     if(m_rotationPoolSize > 0)
     {
-        filename = fmt::format("{}/{}_{}.ctf", m_path, m_filenamePrefix, m_nextRotationPoolIndex);
+        filename = fmt::format("{}/{}_{}.{}", m_path, m_filenamePrefix, m_nextRotationPoolIndex, extension);
 
         m_nextRotationPoolIndex++;
         if(m_nextRotationPoolIndex >= m_rotationPoolSize)
@@ -49,7 +170,7 @@ std::string TraceConfiguration::generateNextFilename()
 
     }
     else
-        filename = fmt::format("{}/{}_{}.ctf", m_path, m_filenamePrefix, cu::getCurrentTimestampUtcFilename(true));
+        filename = fmt::format("{}/{}_{}.{}", m_path, m_filenamePrefix, cu::getCurrentTimestampUtcFilename(true), extension);
 
     return filename;
 }
@@ -90,4 +211,45 @@ void TraceConfiguration::setRotationPoolSize(uint32_t newRotationPoolSize)
     m_nextRotationPoolIndex = 0;
 }
 
+void TraceConfiguration::setTraceFormat(TraceFormat newTraceFormat)
+{
+    m_traceFormat = newTraceFormat;
+}
+
+void TraceConfiguration::enableCompression(bool newEnableCompression)
+{
+    m_enableCompression = newEnableCompression;
+}
+
+std::shared_ptr<AsyncTraceWriter> TraceConfiguration::asyncTraceWriter() const
+{
+    return m_asyncTraceWriter;
+}
+
+void TraceConfiguration::setAsyncTraceWriter(std::shared_ptr<AsyncTraceWriter> newAsyncTraceWriter)
+{
+    m_asyncTraceWriter = std::move(newAsyncTraceWriter);
+}
+
+std::shared_ptr<MappedTracePool> TraceConfiguration::mappedTracePool() const
+{
+    return m_mappedTracePool;
+}
+
+void TraceConfiguration::setMappedTracePool(std::shared_ptr<MappedTracePool> newMappedTracePool)
+{
+    m_mappedTracePool = std::move(newMappedTracePool);
+}
+
+void TraceConfiguration::enableConditionalCapture(const TraceCapturePolicy &policy)
+{
+    m_capturePolicy = policy;
+    m_enableConditionalCapture = true;
+}
+
+void TraceConfiguration::disableConditionalCapture()
+{
+    m_enableConditionalCapture = false;
+}
+
 }
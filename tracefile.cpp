@@ -35,39 +35,56 @@ void TraceFile::finalize()
 
 void TraceFile::traceCurlDebugInfo([[maybe_unused]] CURL *handle, curl_infotype type, char *data, size_t size)
 {
-    auto now = std::chrono::steady_clock::now();
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_timepointTransferBegin);
+    writeCurlDebugInfo(m_file, type, data, size, time, tracePayload(type, size, m_enableSslData, m_maxDataSize, m_dataSize), m_maxDataSize);
+    m_file.flush(); // every entry is on disk, when the process crashes; AsyncTraceFile doesn't block the transfer for it
+}
+
+TracePayload TraceFile::tracePayload(curl_infotype type, size_t size, bool enableSslData, uint32_t maxDataSize, uint32_t &dataSize)
+{
+    if((enableSslData == false) &&  ((type == CURLINFO_SSL_DATA_IN) || (type == CURLINFO_SSL_DATA_OUT)) )
+        return TracePayload::HIDDEN;
+
+    if((type == CURLINFO_DATA_IN) || (type == CURLINFO_DATA_OUT))
+    {
+        if((maxDataSize > 0) && (dataSize > maxDataSize))
+            return TracePayload::TRUNCATED;
+
+        dataSize += size;
+    }
+
+    return TracePayload::DATA;
+}
 
+void TraceFile::writeCurlDebugInfo(std::ostream &stream, curl_infotype type, char *data, size_t size, std::chrono::milliseconds time,
+                                   TracePayload payload, uint32_t maxDataSize)
+{
     switch(type)
     {
-    case CURLINFO_TEXT:         m_file << "### INFO: ";     break;
-    case CURLINFO_HEADER_IN:    m_file << "### HDR_IN: ";   break;
-    case CURLINFO_HEADER_OUT:   m_file << "### HDR_OUT: ";  break;
-    case CURLINFO_DATA_IN:      m_file << "### DATA_IN: ";  break;
-    case CURLINFO_DATA_OUT:     m_file << "### DATA_OUT: "; break;
-    case CURLINFO_SSL_DATA_IN:  m_file << "### SSL_IN: ";   break;
-    case CURLINFO_SSL_DATA_OUT: m_file << "### SSL_OUT: ";  break;
+    case CURLINFO_TEXT:         stream << "### INFO: ";     break;
+    case CURLINFO_HEADER_IN:    stream << "### HDR_IN: ";   break;
+    case CURLINFO_HEADER_OUT:   stream << "### HDR_OUT: ";  break;
+    case CURLINFO_DATA_IN:      stream << "### DATA_IN: ";  break;
+    case CURLINFO_DATA_OUT:     stream << "### DATA_OUT: "; break;
+    case CURLINFO_SSL_DATA_IN:  stream << "### SSL_IN: ";   break;
+    case CURLINFO_SSL_DATA_OUT: stream << "### SSL_OUT: ";  break;
     case CURLINFO_END:                                      break;
     }
-    m_file << std::to_string(size) << " bytes, time " << std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(now - m_timepointTransferBegin).count()) << " ms ###" << std::endl;
+    stream << size << " bytes, time " << time.count() << " ms ###\n";
 
-    if((m_enableSslData == false) &&  ((type == CURLINFO_SSL_DATA_IN) || (type == CURLINFO_SSL_DATA_OUT)) )
+    if(payload == TracePayload::HIDDEN)
         return;
 
-    if((type == CURLINFO_DATA_IN) || (type == CURLINFO_DATA_OUT))
+    if(payload == TracePayload::TRUNCATED)
     {
-        if((m_maxDataSize > 0) && (m_dataSize > m_maxDataSize))
-        {
-            m_file << "<Truncated due to max data size " << std::to_string(m_maxDataSize) << ">" << std::endl;
-            return;
-        }
-
-        m_dataSize += size;
+        stream << "<Truncated due to max data size " << maxDataSize << ">\n";
+        return;
     }
 
     if((type == CURLINFO_TEXT) || (type == CURLINFO_HEADER_IN) || (type == CURLINFO_HEADER_OUT))
-        m_file.write(data, size);
+        stream.write(data, size);
     else
-        m_file << cu::Hexdump(reinterpret_cast<unsigned char *>(data), size) << std::endl;
+        stream << cu::Hexdump(reinterpret_cast<unsigned char *>(data), size) << '\n';
 }
 
 void TraceFile::traceMessage(std::string_view entry)
@@ -0,0 +1,122 @@
+#include "libcurl-wrapper/uploadsource.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace curl
+{
+
+MemoryUploadSource::MemoryUploadSource(const char *data, size_t size)
+    : m_data(data),
+      m_size(size)
+{
+
+}
+
+int64_t MemoryUploadSource::size() const
+{
+    return static_cast<int64_t>(m_size);
+}
+
+bool MemoryUploadSource::rewind()
+{
+    m_offset = 0;
+    return true;
+}
+
+size_t MemoryUploadSource::read(char *buffer, size_t capacity)
+{
+    size_t bytes = std::min(capacity, m_size - m_offset);
+    std::memcpy(buffer, m_data + m_offset, bytes);
+    m_offset += bytes;
+    return bytes;
+}
+
+FileDescriptorUploadSource::FileDescriptorUploadSource(int fd, int64_t size)
+    : m_fd(fd),
+      m_size(size)
+{
+    off_t offset = ::lseek(m_fd, 0, SEEK_CUR);
+    if(offset >= 0)
+        m_startOffset = offset;
+
+    struct stat fileStatus;
+    if((m_size < 0) && (m_startOffset >= 0) && (::fstat(m_fd, &fileStatus) == 0) && S_ISREG(fileStatus.st_mode))
+        m_size = std::max<int64_t>(fileStatus.st_size - m_startOffset, 0);
+}
+
+int64_t FileDescriptorUploadSource::size() const
+{
+    return m_size;
+}
+
+bool FileDescriptorUploadSource::rewind()
+{
+    if(!m_started)
+        return true;
+
+    if((m_startOffset < 0) || (::lseek(m_fd, m_startOffset, SEEK_SET) < 0))
+        return false;
+
+    m_started = false;
+    return true;
+}
+
+size_t FileDescriptorUploadSource::read(char *buffer, size_t capacity)
+{
+    m_started = true;
+
+    for(;;)
+    {
+        ssize_t bytes = ::read(m_fd, buffer, capacity);
+        if(bytes >= 0)
+            return static_cast<size_t>(bytes);
+
+        if(errno == EINTR)
+            continue;
+
+        if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return readPause;
+
+        return readAbort;
+    }
+}
+
+GeneratorUploadSource::GeneratorUploadSource(const UploadGenerator &generator, const UploadRewind &rewind, int64_t size)
+    : m_generator(generator),
+      m_rewind(rewind),
+      m_size(size)
+{
+
+}
+
+int64_t GeneratorUploadSource::size() const
+{
+    return m_size;
+}
+
+bool GeneratorUploadSource::rewind()
+{
+    if(!m_started)
+        return true;
+
+    if(!m_rewind || !m_rewind())
+        return false;
+
+    m_started = false;
+    return true;
+}
+
+size_t GeneratorUploadSource::read(char *buffer, size_t capacity)
+{
+    if(!m_generator)
+        return readAbort;
+
+    m_started = true;
+    return m_generator(buffer, capacity);
+}
+
+}